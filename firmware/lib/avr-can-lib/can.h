@@ -89,6 +89,7 @@ typedef enum {
 	BITRATE_250_KBPS = 5,	// ungetestet
 	BITRATE_500_KBPS = 6,	// ungetestet
 	BITRATE_1_MBPS = 7,		// ungetestet
+	BITRATE_CUSTOM = 8,		// nur MCP2515, siehe tools/can_bittiming.py
 } can_bitrate_t;
 
 /**
@@ -259,6 +260,23 @@ typedef struct {
 	uint8_t tx;				//!< Sende-Register
 } can_error_register_t;
 
+// ----------------------------------------------------------------------------
+/**
+ * \ingroup can_interface
+ * \brief   Fehlerzaehler und Fehlerstatus
+ */
+typedef struct {
+	uint8_t rx;				//!< Empfangs-Fehlerzaehler (REC)
+	uint8_t tx;				//!< Sende-Fehlerzaehler (TEC)
+	uint8_t flags;			//!< CAN_ERROR_* Bits
+} can_error_state_t;
+
+#define	CAN_ERROR_WARNING		(1<<0)	//!< TEC oder REC >= 96
+#define	CAN_ERROR_RX_PASSIVE	(1<<1)	//!< REC >= 128
+#define	CAN_ERROR_TX_PASSIVE	(1<<2)	//!< TEC >= 128
+#define	CAN_ERROR_BUS_OFF		(1<<3)	//!< TEC > 255
+#define	CAN_ERROR_RX_OVERFLOW	(1<<4)	//!< ein Empfangspuffer ist uebergelaufen
+
 // ----------------------------------------------------------------------------
 /**
  * \ingroup can_interface
@@ -284,6 +302,47 @@ typedef enum {
 extern bool
 can_init(can_bitrate_t bitrate);
 
+// ----------------------------------------------------------------------------
+/**
+ * \ingroup	can_interface
+ * \brief	State of a non blocking start, see can_start_poll()
+ */
+typedef enum {
+	CAN_START_BUSY,			//!< still waiting for the controller
+	CAN_START_READY,		//!< in normal mode, with filters loaded
+	CAN_START_FAILED		//!< controller did not answer, call can_start() again
+} can_start_status_t;
+
+// ----------------------------------------------------------------------------
+/**
+ * \ingroup	can_interface
+ * \brief	Starts the CAN interface without blocking
+ *
+ * Only issues the reset. The bit timing, the filters and the return to
+ * normal mode are done by can_start_poll(), so it must be called (e.g. once
+ * per main loop tick) until it returns CAN_START_READY or CAN_START_FAILED.
+ * Only implemented for the MCP2515.
+ *
+ * \param	bitrate	Gewuenschte Geschwindigkeit des CAN Interfaces
+ * \param	filter	filters as in can_static_filter(), or NULL to keep the
+ *					reset state (accept all)
+ *
+ * \return	false if the bitrate is invalid
+ */
+extern bool
+can_start(can_bitrate_t bitrate, const uint8_t *filter);
+
+// ----------------------------------------------------------------------------
+/**
+ * \ingroup	can_interface
+ * \brief	Advances the start of the CAN interface by one step
+ *
+ * Each call reads CANSTAT at most once. It gives up after
+ * MCP2515_START_MAX_POLLS calls without progress.
+ */
+extern can_start_status_t
+can_start_poll(void);
+
 // ----------------------------------------------------------------------------
 /**
  * \ingroup	can_interface
@@ -399,6 +458,44 @@ can_disable_filter(uint8_t number);
 extern void
 can_static_filter(const uint8_t *filter_array);
 
+// ----------------------------------------------------------------------------
+/**
+ * \ingroup	can_interface
+ * \brief	Size of a filter image, see can_build_filters()
+ */
+#define	CAN_FILTER_IMAGE_SIZE	32
+
+// ----------------------------------------------------------------------------
+/**
+ * \ingroup	can_interface
+ * \brief	Encodes a whole filter set into an image in RAM
+ *
+ * The image has the same layout as the table of can_static_filter(). As in
+ * can_set_filter(), mask 0 is taken from filter 0 and mask 1 from filter 2.
+ *
+ * \param	image	CAN_FILTER_IMAGE_SIZE bytes
+ * \param	filter	the six filters
+ *
+ * \warning	Only implemented for the MCP2515
+ */
+extern void
+can_build_filters(uint8_t *image, const can_filter_t *filter);
+
+// ----------------------------------------------------------------------------
+/**
+ * \ingroup	can_interface
+ * \brief	Loads a filter image built by can_build_filters()
+ *
+ * Unlike calling can_set_filter() for each filter, the configuration mode
+ * is entered only once and every filter and mask is written in a single
+ * SPI transaction. Nothing is received until it returns. The previous
+ * operation mode is restored.
+ *
+ * \warning	Only implemented for the MCP2515
+ */
+extern void
+can_load_filters(const uint8_t *image);
+
 // ----------------------------------------------------------------------------
 /**
  * \ingroup	can_interface
@@ -485,6 +582,21 @@ can_get_message(can_t *msg);
 extern can_error_register_t
 can_read_error_register(void);
 
+// ----------------------------------------------------------------------------
+/**
+ * \ingroup	can_interface
+ *
+ * \~german
+ * \brief	Liest Fehlerzaehler und Fehlerstatus in einem einzigen Zugriff
+ *
+ * \~english
+ * \brief	Reads the error counters and the error flags in a single access
+ *
+ * \warning	aktuell nur auf dem MCP2515
+ */
+extern void
+can_read_error_state(can_error_state_t *state);
+
 // ----------------------------------------------------------------------------
 /**
  * \ingroup can_interface
@@ -494,7 +606,7 @@ can_read_error_register(void);
  *
  * \return  true wenn der Bus-Off-Status aktiv ist, false ansonsten
  *
- * \warning aktuell nur auf dem SJA1000
+ * \warning aktuell nur auf dem SJA1000 und MCP2515
  */
 extern bool
 can_check_bus_off(void);
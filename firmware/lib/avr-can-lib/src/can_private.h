@@ -73,6 +73,8 @@
 	#if (BUILD_FOR_MCP2515 == 1)
 
 		#define mcp2515_init(...)					can_init(__VA_ARGS__)
+		#define mcp2515_start(...)					can_start(__VA_ARGS__)
+		#define mcp2515_start_poll(...)				can_start_poll(__VA_ARGS__)
 		#define mcp2515_sleep(...)					can_sleep(__VA_ARGS__)
 		#define mcp2515_wakeup(...)					can_wakeup(__VA_ARGS__)
 		#define mcp2515_check_free_buffer(...)		can_check_free_buffer(__VA_ARGS__)
@@ -80,9 +82,13 @@
 		#define mcp2515_get_filter(...)				can_get_filter(__VA_ARGS__)
 		#define mcp2515_static_filter(...)			can_static_filter(__VA_ARGS__)
 		#define mcp2515_set_filter(...)				can_set_filter(__VA_ARGS__)
+		#define mcp2515_build_filters(...)			can_build_filters(__VA_ARGS__)
+		#define mcp2515_load_filters(...)			can_load_filters(__VA_ARGS__)
 		#define mcp2515_get_message(...)			can_get_message(__VA_ARGS__)
 		#define mcp2515_send_message(...)			can_send_message(__VA_ARGS__)
 		#define	mcp2515_read_error_register(...)	can_read_error_register(__VA_ARGS__)
+		#define	mcp2515_check_bus_off(...)			can_check_bus_off(__VA_ARGS__)
+		#define	mcp2515_read_error_state(...)		can_read_error_state(__VA_ARGS__)
 		#define	mcp2515_set_mode(...)				can_set_mode(__VA_ARGS__)
 
 	#elif (BUILD_FOR_AT90CAN == 1)
@@ -48,23 +48,9 @@
 // -------------------------------------------------------------------------
 
 #include "mcp2515_private.h"
+#include "mcp2515_bittiming.h"
 #ifdef	SUPPORT_FOR_MCP2515__
 
-#ifndef	MCP2515_CLKOUT_PRESCALER
-	#error	MCP2515_CLKOUT_PRESCALER not defined!
-#elif MCP2515_CLKOUT_PRESCALER == 0
-	#define	CLKOUT_PRESCALER_	0x0
-#elif MCP2515_CLKOUT_PRESCALER == 1
-	#define	CLKOUT_PRESCALER_	0x4
-#elif MCP2515_CLKOUT_PRESCALER == 2
-	#define	CLKOUT_PRESCALER_	0x5
-#elif MCP2515_CLKOUT_PRESCALER == 4
-	#define	CLKOUT_PRESCALER_	0x6
-#elif MCP2515_CLKOUT_PRESCALER == 8
-	#define	CLKOUT_PRESCALER_	0x7
-#else
-	#error	invaild value of MCP2515_CLKOUT_PRESCALER
-#endif
 
 // -------------------------------------------------------------------------
 void mcp2515_write_register( uint8_t adress, uint8_t data )
@@ -125,7 +111,7 @@ uint8_t mcp2515_read_status(uint8_t type)
 
 // -------------------------------------------------------------------------
 
-const uint8_t _mcp2515_cnf[8][3] PROGMEM = {
+const uint8_t _mcp2515_cnf[9][3] PROGMEM = {
 	// 10 kbps
 	{	0x04,
 		0xb6,
@@ -165,15 +151,17 @@ const uint8_t _mcp2515_cnf[8][3] PROGMEM = {
 	{	(1<<PHSEG21),
 		(1<<BTLMODE)|(1<<PHSEG11),
 		0
+	},
+	// BITRATE_CUSTOM, siehe mcp2515_bittiming.h
+	{	MCP2515_BT_CNF3,
+		MCP2515_BT_CNF2,
+		MCP2515_BT_CNF1
 	}
 };
 
 // -------------------------------------------------------------------------
-bool mcp2515_init(can_bitrate_t bitrate)
+void mcp2515_init_interface(void)
 {
-	if (bitrate >= 8)
-		return false;
-	
 	SET(MCP2515_CS);
 	SET_OUTPUT(MCP2515_CS);
 	
@@ -188,19 +176,11 @@ bool mcp2515_init(can_bitrate_t bitrate)
 	
 	// SPI Einstellung setzen
 	mcp2515_spi_init();
-	
-	// MCP2515 per Software Reset zuruecksetzten,
-	// danach ist er automatisch im Konfigurations Modus
-	RESET(MCP2515_CS);
-	spi_putc(SPI_RESET);
-	
-	_delay_ms(1);
-	
-	SET(MCP2515_CS);
-	
-	// ein bisschen warten bis der MCP2515 sich neu gestartet hat
-	_delay_ms(10);
-	
+}
+
+// -------------------------------------------------------------------------
+bool mcp2515_configure(can_bitrate_t bitrate)
+{
 	// CNF1..3 Register laden (Bittiming)
 	RESET(MCP2515_CS);
 	spi_putc(SPI_WRITE);
@@ -242,10 +222,30 @@ bool mcp2515_init(can_bitrate_t bitrate)
 	
 	// Testen ob das auf die beschreibenen Register zugegriffen werden kann
 	// (=> ist der Chip ueberhaupt ansprechbar?)
-	bool error = false;
-	if (mcp2515_read_register(CNF2) != pgm_read_byte(&_mcp2515_cnf[bitrate][1])) {
-		error = true;
-	}
+	return mcp2515_read_register(CNF2) == pgm_read_byte(&_mcp2515_cnf[bitrate][1]);
+}
+
+// -------------------------------------------------------------------------
+bool mcp2515_init(can_bitrate_t bitrate)
+{
+	if (bitrate > BITRATE_CUSTOM)
+		return false;
+	
+	mcp2515_init_interface();
+	
+	// MCP2515 per Software Reset zuruecksetzten,
+	// danach ist er automatisch im Konfigurations Modus
+	RESET(MCP2515_CS);
+	spi_putc(SPI_RESET);
+	
+	_delay_ms(1);
+	
+	SET(MCP2515_CS);
+	
+	// ein bisschen warten bis der MCP2515 sich neu gestartet hat
+	_delay_ms(10);
+	
+	bool error = !mcp2515_configure(bitrate);
 	
 	// Device zurueck in den normalen Modus versetzten
 	// und aktivieren/deaktivieren des Clkout-Pins
@@ -0,0 +1,27 @@
+// ----------------------------------------------------------------------------
+/* MCP2515 bit timing for BITRATE_CUSTOM, generated by tools/can_bittiming.py:
+ *
+ *  ./tools/can_bittiming.py --osc 16000000 --bitrate 1000000 --sample-point 75 -o lib/avr-can-lib/src/mcp2515_bittiming.h
+ *
+ * 16000000 Hz, 1000000 bps -> 1000000.0 bps (0 ppm),
+ * 8 TQ of 125.0 ns, sample point 75.0 %
+ * (CNF1 0x00, CNF2 0x8a, CNF3 0x01)
+ */
+// ----------------------------------------------------------------------------
+
+#ifndef	MCP2515_BITTIMING_H
+#define	MCP2515_BITTIMING_H
+
+#define	MCP2515_BT_OSC				16000000UL
+#define	MCP2515_BT_BITRATE			1000000UL
+#define	MCP2515_BT_MAX_ERROR_PPM	5000UL
+
+#define	MCP2515_BT_BRP				1
+#define	MCP2515_BT_PROPSEG			3
+#define	MCP2515_BT_PS1				2
+#define	MCP2515_BT_PS2				2
+#define	MCP2515_BT_SJW				1
+
+#include "mcp2515_bittiming_check.h"
+
+#endif	// MCP2515_BITTIMING_H
@@ -0,0 +1,50 @@
+// coding: utf-8
+// ----------------------------------------------------------------------------
+/* Checks the bit timing of mcp2515_bittiming.h and derives the CNF1..3
+ * values. Everything that the MCP2515 or the CAN specification does not
+ * accept is rejected here, at compile time.
+ */
+// ----------------------------------------------------------------------------
+
+#ifndef	MCP2515_BITTIMING_CHECK_H
+#define	MCP2515_BITTIMING_CHECK_H
+
+#define	MCP2515_BT_NTQ		(1 + MCP2515_BT_PROPSEG + MCP2515_BT_PS1 + MCP2515_BT_PS2)
+
+#if MCP2515_BT_BRP < 1 || MCP2515_BT_BRP > 64
+	#error	"MCP2515_BT_BRP must be 1..64"
+#endif
+#if MCP2515_BT_PROPSEG < 1 || MCP2515_BT_PROPSEG > 8
+	#error	"MCP2515_BT_PROPSEG must be 1..8"
+#endif
+#if MCP2515_BT_PS1 < 1 || MCP2515_BT_PS1 > 8
+	#error	"MCP2515_BT_PS1 must be 1..8"
+#endif
+#if MCP2515_BT_PS2 < 2 || MCP2515_BT_PS2 > 8
+	#error	"MCP2515_BT_PS2 must be 2..8"
+#endif
+#if MCP2515_BT_SJW < 1 || MCP2515_BT_SJW > 4 || MCP2515_BT_SJW >= MCP2515_BT_PS2
+	#error	"MCP2515_BT_SJW must be 1..4 and below MCP2515_BT_PS2"
+#endif
+#if MCP2515_BT_PROPSEG + MCP2515_BT_PS1 < MCP2515_BT_PS2
+	#error	"MCP2515_BT_PROPSEG + MCP2515_BT_PS1 must not be below MCP2515_BT_PS2"
+#endif
+#if MCP2515_BT_NTQ < 8 || MCP2515_BT_NTQ > 25
+	#error	"a bit must have 8..25 TQ"
+#endif
+
+// Fosc / (2 * BRP * NTQ) against the requested bitrate
+#define	MCP2515_BT_NOMINAL	(2UL * MCP2515_BT_BRP * MCP2515_BT_NTQ * MCP2515_BT_BITRATE)
+#define	MCP2515_BT_ERROR_PPM	\
+		(((MCP2515_BT_OSC > MCP2515_BT_NOMINAL) ? (MCP2515_BT_OSC - MCP2515_BT_NOMINAL) \
+			: (MCP2515_BT_NOMINAL - MCP2515_BT_OSC)) * 1000000UL / MCP2515_BT_NOMINAL)
+
+#if MCP2515_BT_ERROR_PPM > MCP2515_BT_MAX_ERROR_PPM
+	#error	"MCP2515_BT_OSC can not give MCP2515_BT_BITRATE within MCP2515_BT_MAX_ERROR_PPM"
+#endif
+
+#define	MCP2515_BT_CNF1		(((MCP2515_BT_SJW - 1) << 6) | (MCP2515_BT_BRP - 1))
+#define	MCP2515_BT_CNF2		((1<<7) | ((MCP2515_BT_PS1 - 1) << 3) | (MCP2515_BT_PROPSEG - 1))
+#define	MCP2515_BT_CNF3		(MCP2515_BT_PS2 - 1)
+
+#endif	// MCP2515_BITTIMING_CHECK_H
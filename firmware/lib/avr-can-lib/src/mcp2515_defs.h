@@ -259,6 +259,7 @@
 #define RX1OVR		7
 #define RX0OVR		6
 #define TXB0		5
+#define TXBO		5		// TXB0 is a typo, kept for compatibility
 #define TXEP		4
 #define RXEP		3
 #define TXWAR		2
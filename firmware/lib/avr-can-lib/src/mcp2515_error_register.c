@@ -42,4 +42,45 @@ can_error_register_t mcp2515_read_error_register(void)
 	return error;
 }
 
+// ----------------------------------------------------------------------------
+// TEC, REC, ..., CANINTF, EFLG sind aufeinanderfolgende Register (0x1C..0x2D),
+// daher werden sie mit einem einzigen READ gelesen, statt mit drei.
+void mcp2515_read_error_state(can_error_state_t *state)
+{
+	uint8_t eflg;
+	
+	RESET(MCP2515_CS);
+	
+	spi_putc(SPI_READ);
+	spi_putc(TEC);
+	
+	state->tx = spi_putc(0xff);
+	state->rx = spi_putc(0xff);
+	
+	for (uint8_t i = REC + 1; i < EFLG; i++)
+		spi_putc(0xff);
+	
+	eflg = spi_putc(0xff);
+	
+	SET(MCP2515_CS);
+	
+	state->flags = 0;
+	if (eflg & (1<<EWARN))
+		state->flags |= CAN_ERROR_WARNING;
+	if (eflg & (1<<RXEP))
+		state->flags |= CAN_ERROR_RX_PASSIVE;
+	if (eflg & (1<<TXEP))
+		state->flags |= CAN_ERROR_TX_PASSIVE;
+	if (eflg & (1<<TXBO))
+		state->flags |= CAN_ERROR_BUS_OFF;
+	if (eflg & ((1<<RX0OVR) | (1<<RX1OVR)))
+		state->flags |= CAN_ERROR_RX_OVERFLOW;
+}
+
+// ----------------------------------------------------------------------------
+bool mcp2515_check_bus_off(void)
+{
+	return (mcp2515_read_register(EFLG) & (1<<TXBO)) ? true : false;
+}
+
 #endif	// SUPPORT_FOR_MCP2515__
@@ -110,6 +110,22 @@
 	#error	MCP2515_CS ist nicht definiert!
 #endif
 
+#ifndef	MCP2515_CLKOUT_PRESCALER
+	#error	MCP2515_CLKOUT_PRESCALER not defined!
+#elif MCP2515_CLKOUT_PRESCALER == 0
+	#define	CLKOUT_PRESCALER_	0x0
+#elif MCP2515_CLKOUT_PRESCALER == 1
+	#define	CLKOUT_PRESCALER_	0x4
+#elif MCP2515_CLKOUT_PRESCALER == 2
+	#define	CLKOUT_PRESCALER_	0x5
+#elif MCP2515_CLKOUT_PRESCALER == 4
+	#define	CLKOUT_PRESCALER_	0x6
+#elif MCP2515_CLKOUT_PRESCALER == 8
+	#define	CLKOUT_PRESCALER_	0x7
+#else
+	#error	invaild value of MCP2515_CLKOUT_PRESCALER
+#endif
+
 #if defined(MCP2515_RX0BF) && !defined(MCP2515_RX1BF)
 	#warning	only MCP2515_RX0BF but not MCP2515_RX1BF defined!
 #elif !defined(MCP2515_RX0BF) && defined(MCP2515_RX1BF)
@@ -132,6 +148,28 @@ extern uint8_t mcp2515_read_register(uint8_t adress);
 
 extern uint8_t mcp2515_read_status(uint8_t type);
 
+// -------------------------------------------------------------------------
+/**
+ * \brief	Configures the pins and the SPI used by the MCP2515
+ */
+extern void mcp2515_init_interface(void);
+
+// -------------------------------------------------------------------------
+/**
+ * \brief	Loads the bit timing and the pin configuration. Must be called
+ * 			in configuration mode.
+ *
+ * \return	false if the written registers could not be read back
+ */
+extern bool mcp2515_configure(can_bitrate_t bitrate);
+
+// -------------------------------------------------------------------------
+/**
+ * \brief	Loads the acceptance filters and masks (see can_static_filter()).
+ * 			Must be called in configuration mode.
+ */
+extern void mcp2515_write_filters(const uint8_t *filter);
+
 // -------------------------------------------------------------------------
 /**
  * \brief	Setzten/loeschen einzelner Bits
@@ -0,0 +1,121 @@
+// coding: utf-8
+// ----------------------------------------------------------------------------
+/* Batch variant of mcp2515_set_filter(). The whole filter and mask set is
+ * encoded in RAM first (same layout as the table of can_static_filter()), so
+ * the configuration mode, during which nothing is received, is entered only
+ * once and lasts a single burst write.
+ */
+// ----------------------------------------------------------------------------
+
+#include "mcp2515_private.h"
+#ifdef	SUPPORT_FOR_MCP2515__
+
+// ----------------------------------------------------------------------------
+// Kodiert eine ID wie MCP2515_FILTER() bzw. MCP2515_FILTER_EXTENDED()
+
+#if	SUPPORT_EXTENDED_CANID
+
+static uint8_t *mcp2515_encode_id(uint8_t *p, uint32_t id, uint8_t extended)
+{
+	if (extended) {
+		*p++ = id >> 21;
+		*p++ = ((id >> 13) & 0xe0) | (1<<EXIDE) | ((id >> 16) & 0x3);
+		*p++ = id >> 8;
+		*p++ = id;
+	}
+	else {
+		*p++ = id >> 3;
+		*p++ = id << 5;
+		*p++ = 0;
+		*p++ = 0;
+	}
+	
+	return p;
+}
+
+#define	ENCODE(p, f, id)	mcp2515_encode_id(p, (f)->id, ((f)->flags.extended == 0x2) ? 0 : 1)
+
+#else
+
+static uint8_t *mcp2515_encode_id(uint8_t *p, uint16_t id)
+{
+	*p++ = id >> 3;
+	*p++ = id << 5;
+	*p++ = 0;
+	*p++ = 0;
+	
+	return p;
+}
+
+#define	ENCODE(p, f, id)	mcp2515_encode_id(p, (f)->id)
+
+#endif
+
+// ----------------------------------------------------------------------------
+void mcp2515_build_filters(uint8_t *image, const can_filter_t *filter)
+{
+	uint8_t i;
+	
+	for (i = 0; i < 6; i++)
+		image = ENCODE(image, &filter[i], id);
+	
+	// Maske 0 gilt fuer die Filter 0 und 1, Maske 1 fuer 2 bis 5
+	image = ENCODE(image, &filter[0], mask);
+	ENCODE(image, &filter[2], mask);
+}
+
+// ----------------------------------------------------------------------------
+void mcp2515_load_filters(const uint8_t *image)
+{
+	// Register zwischen den Filtern, die beim Burst mitgeschrieben werden
+	uint8_t bfpctrl = mcp2515_read_register(BFPCTRL);
+	uint8_t txrtsctrl = mcp2515_read_register(TXRTSCTRL);
+	uint8_t mode = mcp2515_read_register(CANSTAT) & 0xe0;
+	uint8_t canctrl = (mcp2515_read_register(CANCTRL) & ~0xe0) | (1<<REQOP2);
+	uint8_t adress;
+	
+	// ausserhalb des Fensters, damit es so kurz wie moeglich bleibt
+	mcp2515_write_register(RXB0CTRL, (1<<BUKT));
+	mcp2515_write_register(RXB1CTRL, 0);
+	
+	mcp2515_change_operation_mode( (1<<REQOP2) );
+	
+	RESET(MCP2515_CS);
+	spi_putc(SPI_WRITE);
+	spi_putc(RXF0SIDH);
+	
+	for (adress = RXF0SIDH; adress < RXM1SIDH + 4; adress++)
+	{
+		uint8_t data;
+		
+		switch (adress) {
+			case BFPCTRL:
+				data = bfpctrl;
+				break;
+			case TXRTSCTRL:
+				data = txrtsctrl;
+				break;
+			case CANCTRL:
+			case CANCTRL + 0x10:
+				data = canctrl;
+				break;
+			case CANSTAT:
+			case CANSTAT + 0x10:
+			case TEC:
+			case REC:
+				data = 0;			// nur lesbar
+				break;
+			default:
+				data = *image++;
+				break;
+		}
+		
+		spi_putc(data);
+	}
+	
+	SET(MCP2515_CS);
+	
+	mcp2515_change_operation_mode( mode );
+}
+
+#endif	// SUPPORT_FOR_MCP2515__
@@ -0,0 +1,98 @@
+// coding: utf-8
+// ----------------------------------------------------------------------------
+/* Non blocking variant of mcp2515_init(). Instead of the fixed delays after
+ * the reset and the unbounded wait for the normal mode, CANSTAT is polled
+ * once per call of mcp2515_start_poll(), which fails after
+ * MCP2515_START_MAX_POLLS calls without progress.
+ */
+// ----------------------------------------------------------------------------
+
+#include "mcp2515_private.h"
+#ifdef	SUPPORT_FOR_MCP2515__
+
+#ifndef	MCP2515_START_MAX_POLLS
+	#define	MCP2515_START_MAX_POLLS		32
+#endif
+
+enum {
+	START_IDLE,
+	START_WAIT_CONFIG,
+	START_WAIT_NORMAL,
+};
+
+static uint8_t _start_state = START_IDLE;
+static uint8_t _start_polls;
+static can_bitrate_t _start_bitrate;
+static const uint8_t *_start_filter;
+
+// ----------------------------------------------------------------------------
+bool mcp2515_start(can_bitrate_t bitrate, const uint8_t *filter)
+{
+	if (bitrate > BITRATE_CUSTOM)
+		return false;
+	
+	_start_bitrate = bitrate;
+	_start_filter = filter;
+	_start_polls = 0;
+	
+	mcp2515_init_interface();
+	
+	// software reset, the device enters the configuration mode when its
+	// oscillator is up again
+	RESET(MCP2515_CS);
+	spi_putc(SPI_RESET);
+	SET(MCP2515_CS);
+	
+	_start_state = START_WAIT_CONFIG;
+	
+	return true;
+}
+
+// ----------------------------------------------------------------------------
+can_start_status_t mcp2515_start_poll(void)
+{
+	uint8_t mode;
+	
+	switch (_start_state)
+	{
+		case START_WAIT_CONFIG:
+			mode = mcp2515_read_register(CANSTAT) & 0xe0;
+			if (mode != (1<<REQOP2))
+				break;
+			
+			if (!mcp2515_configure(_start_bitrate)) {
+				_start_state = START_IDLE;
+				return CAN_START_FAILED;
+			}
+			
+			if (_start_filter)
+				mcp2515_write_filters(_start_filter);
+			
+			// back to normal mode
+			mcp2515_write_register(CANCTRL, CLKOUT_PRESCALER_);
+			
+			_start_state = START_WAIT_NORMAL;
+			_start_polls = 0;
+			return CAN_START_BUSY;
+		
+		case START_WAIT_NORMAL:
+			mode = mcp2515_read_register(CANSTAT) & 0xe0;
+			if (mode != 0)
+				break;
+			
+			_start_state = START_IDLE;
+			return CAN_START_READY;
+		
+		default:
+			return CAN_START_FAILED;
+	}
+	
+	if (++_start_polls >= MCP2515_START_MAX_POLLS) {
+		_start_state = START_IDLE;
+		return CAN_START_FAILED;
+	}
+	
+	return CAN_START_BUSY;
+}
+
+#endif	// SUPPORT_FOR_MCP2515__
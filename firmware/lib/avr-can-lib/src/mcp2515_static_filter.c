@@ -34,13 +34,8 @@
 // ----------------------------------------------------------------------------
 // Filter setzen
 
-void mcp2515_static_filter(const uint8_t *filter)
+void mcp2515_write_filters(const uint8_t *filter)
 {
-	// change to configuration mode
-	mcp2515_bit_modify(CANCTRL, 0xe0, (1<<REQOP2));
-	while ((mcp2515_read_register(CANSTAT) & 0xe0) != (1<<REQOP2))
-		;
-	
 	mcp2515_write_register(RXB0CTRL, (1<<BUKT));
 	mcp2515_write_register(RXB1CTRL, 0);
     
@@ -60,6 +55,17 @@ void mcp2515_static_filter(const uint8_t *filter)
 		}
 		SET(MCP2515_CS);
 	}
+}
+
+// ----------------------------------------------------------------------------
+void mcp2515_static_filter(const uint8_t *filter)
+{
+	// change to configuration mode
+	mcp2515_bit_modify(CANCTRL, 0xe0, (1<<REQOP2));
+	while ((mcp2515_read_register(CANSTAT) & 0xe0) != (1<<REQOP2))
+		;
+	
+	mcp2515_write_filters(filter);
 	
 	mcp2515_bit_modify(CANCTRL, 0xe0, 0);
 }
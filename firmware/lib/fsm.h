@@ -0,0 +1,187 @@
+/**
+ * @file fsm.h
+ *
+ * @defgroup FSM Table Driven State Machine
+ *
+ * @brief A small state machine engine with its states and transitions kept
+ * in flash.
+ *
+ * Each state has optional entry, run and exit actions and a slice of the
+ * transition table. A transition is taken when its guard returns non-zero
+ * (a NULL guard is always taken); the first one that matches wins. A state
+ * can also be requested explicitly with fsm_request(), which has priority
+ * over the guards. Dispatch is an index into the state table, so its cost
+ * does not depend on the number of states.
+ *
+ * The engine also keeps the accumulated ticks spent in each state and the
+ * last FSM_TRACE_SIZE transitions.
+ *
+ * @code
+ *  enum { ST_A, ST_B, ST_COUNT };
+ *  const fsm_transition_t transitions[] PROGMEM = {
+ *      // from ST_A
+ *      {&a_done, ST_B},
+ *      // from ST_B
+ *      {NULL, ST_A},
+ *  };
+ *  const fsm_state_t states[ST_COUNT] PROGMEM = {
+ *      //          entry   run     exit    first   count
+ *      [ST_A] = {  NULL,   &a_run, NULL,   0,      1},
+ *      [ST_B] = {  &b_in,  NULL,   NULL,   1,      1},
+ *  };
+ *  uint16_t time_in_state[ST_COUNT];
+ *  fsm_t fsm;
+ *
+ *  fsm_init(&fsm, states, transitions, time_in_state, ST_COUNT, ST_A);
+ *  for(;;) fsm_run(&fsm);
+ * @endcode
+ *
+ */
+
+#ifndef _FSM_H_
+#define _FSM_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <avr/pgmspace.h>
+
+#ifndef FSM_TRACE_SIZE
+#define FSM_TRACE_SIZE      8               //<! must be a power of two
+#endif
+
+#define FSM_NO_REQUEST      0xFF
+
+typedef void (*fsm_action_t)(void);
+typedef uint8_t (*fsm_guard_t)(void);
+
+typedef struct fsm_state{
+    fsm_action_t entry;
+    fsm_action_t run;
+    fsm_action_t exit;
+    uint8_t first;                          //<! first transition of this state
+    uint8_t count;                          //<! number of transitions
+} fsm_state_t;
+
+typedef struct fsm_transition{
+    fsm_guard_t guard;                      //<! NULL is always true
+    uint8_t to;
+} fsm_transition_t;
+
+typedef struct fsm_trace{
+    uint8_t from;
+    uint8_t to;
+    uint16_t elapsed;                       //<! ticks spent in `from`
+} fsm_trace_t;
+
+typedef struct fsm{
+    const fsm_state_t *states;              //<! in flash
+    const fsm_transition_t *transitions;    //<! in flash
+    uint16_t *time_in_state;                //<! one counter per state
+    uint8_t state_count;
+    uint8_t state;
+    volatile uint8_t request;
+    uint16_t elapsed;                       //<! ticks in the current state
+    fsm_trace_t trace[FSM_TRACE_SIZE];
+    uint8_t trace_head;                     //<! next trace entry to be written
+    uint8_t trace_count;                    //<! entries written, up to FSM_TRACE_SIZE
+} fsm_t;
+
+/**
+ * @brief leaves the current state and enters the `to` state.
+ */
+static inline void fsm_transition(fsm_t *fsm, uint8_t to)
+{
+    fsm_state_t st;
+    fsm_trace_t *trace = &fsm->trace[fsm->trace_head++ & (FSM_TRACE_SIZE - 1)];
+    if(fsm->trace_count < FSM_TRACE_SIZE) fsm->trace_count++;
+
+    memcpy_P(&st, &fsm->states[fsm->state], sizeof(st));
+    if(st.exit) st.exit();
+
+    trace->from = fsm->state;
+    trace->to = to;
+    trace->elapsed = fsm->elapsed;
+
+    fsm->state = to;
+    fsm->elapsed = 0;
+
+    memcpy_P(&st, &fsm->states[to], sizeof(st));
+    if(st.entry) st.entry();
+}
+
+/**
+ * @brief starts the machine in the `initial` state, running its entry action.
+ */
+static inline void fsm_init(fsm_t *fsm, const fsm_state_t *states,
+        const fsm_transition_t *transitions, uint16_t *time_in_state,
+        uint8_t state_count, uint8_t initial)
+{
+    fsm_state_t st;
+
+    fsm->states = states;
+    fsm->transitions = transitions;
+    fsm->time_in_state = time_in_state;
+    fsm->state_count = state_count;
+    fsm->state = initial;
+    fsm->request = FSM_NO_REQUEST;
+    fsm->elapsed = 0;
+    fsm->trace_head = fsm->trace_count = 0;
+
+    for(uint8_t i = 0; i < state_count; i++) time_in_state[i] = 0;
+
+    memcpy_P(&st, &states[initial], sizeof(st));
+    if(st.entry) st.entry();
+}
+
+/**
+ * @brief requests a transition, taken on the next fsm_run().
+ */
+static inline void fsm_request(fsm_t *fsm, uint8_t state)
+{
+    if(state < fsm->state_count) fsm->request = state;
+}
+
+/**
+ * @brief one tick of the machine: takes a requested or guarded transition
+ * (if any) and then runs the current state.
+ */
+static inline void fsm_run(fsm_t *fsm)
+{
+    fsm_state_t st;
+    uint8_t to = fsm->request;
+
+    memcpy_P(&st, &fsm->states[fsm->state], sizeof(st));
+
+    if(to == FSM_NO_REQUEST){
+        for(uint8_t i = st.first; i < st.first + st.count; i++){
+            fsm_transition_t tr;
+            memcpy_P(&tr, &fsm->transitions[i], sizeof(tr));
+            if(!tr.guard || tr.guard()){
+                to = tr.to;
+                break;
+            }
+        }
+    }else{
+        fsm->request = FSM_NO_REQUEST;
+    }
+
+    if(to != FSM_NO_REQUEST){
+        fsm_transition(fsm, to);
+        memcpy_P(&st, &fsm->states[fsm->state], sizeof(st));
+    }
+
+    if(fsm->elapsed != UINT16_MAX) fsm->elapsed++;
+    if(fsm->time_in_state[fsm->state] != UINT16_MAX) fsm->time_in_state[fsm->state]++;
+
+    if(st.run) st.run();
+}
+
+/**
+ * @brief returns the n-th most recent transition (0 is the last one).
+ */
+static inline const fsm_trace_t *fsm_trace(const fsm_t *fsm, uint8_t n)
+{
+    return &fsm->trace[(uint8_t)(fsm->trace_head - 1 - n) & (FSM_TRACE_SIZE - 1)];
+}
+
+#endif /* ifndef _FSM_H_ */
@@ -0,0 +1,57 @@
+/**
+ * @file lut.h
+ *
+ * @defgroup LUT Lookup Table Interpolation
+ *
+ * @brief Piecewise linear conversion through a table of breakpoints kept in
+ * flash.
+ *
+ * A table has 2^seg_2 + 1 entries, the output at inputs 0, 1 << shift, 2 <<
+ * shift, ... where shift = x_bits - seg_2, so the last entry is the output at
+ * full scale + 1. The segment is the top bits of the input and the remaining
+ * ones are the position inside it in Q8. The interpolation is then two flash
+ * reads, a few shifts and a single 8x8 multiply: consecutive entries must
+ * not differ by more than 255, which tools/adc_lut.py checks.
+ *
+ * @code
+ *  const uint16_t throttle[LUT_SIZE(4)] PROGMEM = { ... };
+ *  uint16_t permille = lut_interp(throttle, 8, 4, adc.channel[ADC1].avg);
+ * @endcode
+ *
+ */
+
+#ifndef _LUT_H_
+#define _LUT_H_
+
+#include <stdint.h>
+#include <avr/pgmspace.h>
+
+#define LUT_SIZE(seg_2)     ((1 << (seg_2)) + 1)
+#define LUT_MAX_STEP        255             //<! between consecutive entries
+
+/**
+ * @brief interpolates the table at x. Meant to be called with constant
+ * x_bits and seg_2, so the shifts are resolved at compile time.
+ * @param lut is the table in flash, LUT_SIZE(seg_2) entries
+ * @param x_bits is the input resolution, x_bits - seg_2 must be 0..8
+ * @param seg_2 is the number of segments in base 2
+ * @param x is the input, 0 to 2^x_bits - 1
+ */
+static inline uint16_t lut_interp(const uint16_t *lut, uint8_t x_bits,
+        uint8_t seg_2, uint16_t x)
+{
+    uint8_t shift = x_bits - seg_2;
+    uint8_t i = x >> shift;
+    uint8_t frac = (uint8_t)(x << (8 - shift));     // Q8 position in the segment
+    uint16_t y0 = pgm_read_word(&lut[i]);
+    uint16_t y1;
+
+    if(!frac) return y0;
+
+    y1 = pgm_read_word(&lut[i + 1]);
+    if(y1 >= y0)
+        return y0 + (((uint16_t)(uint8_t)(y1 - y0) * frac) >> 8);
+    return y0 - (((uint16_t)(uint8_t)(y0 - y1) * frac) >> 8);
+}
+
+#endif /* ifndef _LUT_H_ */
@@ -1,7 +1,151 @@
+#define LOG_MODULE LOG_MODULE_ADC
 #include "adc.h"
+#ifdef ADC_LUT_ON
+#include "adc_lut.h"
+
+#if ADC_LUT_BITS != ADC_BITS
+#error "adc_lut.h was generated for another adc resolution, run tools/adc_lut.py again"
+#endif
+#endif
 
 volatile adc_t adc;
 
+#ifdef ADC_LUT_ON
+#ifndef ADC_LUT_ADC0
+#define ADC_LUT_ADC0    NULL
+#endif
+#ifndef ADC_LUT_ADC1
+#define ADC_LUT_ADC1    NULL
+#endif
+#ifndef ADC_LUT_ADC2
+#define ADC_LUT_ADC2    NULL
+#endif
+
+/**
+ * @brief linearisation table of each channel, NULL for none.
+ */
+static const uint16_t * const adc_lut[ADC_LAST_CHANNEL+1] = {
+    [ADC0] = ADC_LUT_ADC0,
+    [ADC1] = ADC_LUT_ADC1,
+    [ADC2] = ADC_LUT_ADC2,
+};
+
+/**
+ * @brief returns the last average of a channel in its physical units.
+ */
+uint16_t adc_value(adc_channels_t ch)
+{
+    uint16_t avg;
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+        avg = adc.channel[ch].avg;
+    }
+
+    if(!adc_lut[ch]) return avg;
+    return lut_interp(adc_lut[ch], ADC_LUT_BITS, ADC_LUT_SEGMENTS_2, avg);
+}
+#endif
+
+#ifdef ADC_CMP_ON
+/**
+ * @brief comparator thresholds of each channel, on the same scale as avg.
+ */
+static const adc_cmp_t adc_cmp[ADC_LAST_CHANNEL+1] = {
+    [0 ... ADC_LAST_CHANNEL]    = {ADC_CMP_OFF_LOW,             ADC_CMP_OFF_HIGH,           0},
+    [ADC_CMP_POT_CHANNEL]       = {POTENTIOMETER_LOW_TRIGGER,   POTENTIOMETER_HIGH_TRIGGER, ADC_CMP_HYSTERESIS},
+};
+
+/**
+ * @brief schmitt triggers on a new average: a bit is set when crossing its
+ * threshold and cleared only when back past it by the hysteresis.
+ */
+static inline void adc_compare(uint8_t ch, uint16_t avg)
+{
+    const adc_cmp_t *c = &adc_cmp[ch];
+    uint8_t bit = 1 << ch;
+    uint8_t low = adc.low, high = adc.high;
+
+    if(low & bit){
+        if(avg > c->low + c->hysteresis) low &= ~bit;
+    }else if(avg < c->low){
+        low |= bit;
+    }
+
+    if(high & bit){
+        if(avg + c->hysteresis < c->high) high &= ~bit;
+    }else if(avg > c->high){
+        high |= bit;
+    }
+
+    adc.events |= ((low ^ adc.low) | (high ^ adc.high));
+    adc.low = low;
+    adc.high = high;
+}
+
+/**
+ * @brief returns the channels whose comparators changed since the last call.
+ */
+uint8_t adc_take_events(void)
+{
+    uint8_t events;
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+        events = adc.events;
+        adc.events = 0;
+    }
+    return events;
+}
+#endif
+
+#ifdef ADC_CAL_ON
+/**
+ * @brief applies the calibration to the sum of ADC_AVG_SIZE_10 samples: the
+ * gnd offset is removed and the gain scales it to the nominal supply.
+ */
+static inline uint16_t adc_correct(uint32_t sum)
+{
+    uint16_t offset = adc.cal.offset;
+    uint16_t avg;
+
+    if(sum <= offset) return 0;
+
+    avg = ((sum - offset) * adc.cal.gain) >> (ADC_AVG_SIZE_2 + ADC_CAL_GAIN_Q);
+    return avg > ADC_MAX ? ADC_MAX : avg;
+}
+
+/**
+ * @brief updates the estimates with a conversion of a calibration channel.
+ * @return the next channel to convert
+ */
+static inline adc_channels_t adc_calibrate(uint16_t sample)
+{
+    if(adc.select == ADC_BANDGAP){
+        // the bandgap takes a while to settle after being selected
+        if(adc.cal.settle){
+            adc.cal.settle--;
+            return ADC_BANDGAP;
+        }
+        adc.cal.bandgap += sample - (adc.cal.bandgap >> ADC_CAL_FILTER_2);
+        return ADC_GND;
+    }
+
+    adc.cal.gnd += sample - (adc.cal.gnd >> ADC_CAL_FILTER_2);
+    adc.cal.offset = ((uint32_t)adc.cal.gnd * ADC_AVG_SIZE_10) >> ADC_CAL_FILTER_2;
+
+    // only once every ADC_CAL_PERIOD cycles, so the division is affordable
+    if(adc.cal.bandgap > adc.cal.gnd){
+        uint32_t gain = ((uint32_t)ADC_CAL_BANDGAP_NOMINAL << ADC_CAL_GAIN_Q)
+            / (adc.cal.bandgap - adc.cal.gnd);
+        if(gain >= ADC_CAL_GAIN_MIN && gain <= ADC_CAL_GAIN_MAX){
+            adc.cal.gain = gain;
+            return ADC0;
+        }
+    }
+    adc.cal.rejects++;                              // keeps the last good gain
+    return ADC0;
+}
+#endif
+
 /**
  * @brief Changes ADC channel
  * @param __ch is the channel to be switched to
@@ -11,7 +155,7 @@ inline uint8_t adc_select_channel(adc_channels_t __ch)
 {
     if(__ch < ADC_LAST_CHANNEL ) adc.select = __ch;
 
-    ADMUX = (ADMUX & 0xF8) | adc.select; // clears the bottom 3 bits before ORing
+    ADMUX = (ADMUX & 0xF0) | adc.select; // clears the mux bits before ORing
     return adc.select;
 }
 
@@ -22,6 +166,18 @@ void adc_init(void)
 {
     adc.ready = 0;
     adc.select = ADC0;
+#ifdef ADC_CMP_ON
+    adc.low = adc.high = adc.events = 0;
+#endif
+    for(uint8_t i = 0; i <= ADC_LAST_CHANNEL; i++)
+        adc.channel[i].sum = adc.channel[i].samples = 0;
+#ifdef ADC_CAL_ON
+    // starts from the nominal supply, converging in 2^ADC_CAL_FILTER_2 calibrations
+    adc.cal.bandgap = ADC_CAL_BANDGAP_NOMINAL;
+    adc.cal.gnd = adc.cal.offset = 0;
+    adc.cal.gain = ADC_CAL_GAIN_ONE;
+    adc.cal.cycle = adc.cal.settle = 0;
+#endif
 
     //clr_bit(PRR0, PRADC);                           // Activates clock to adc
 
@@ -29,7 +185,7 @@ void adc_init(void)
     clr_bit(PORTC,ADC0);
     clr_bit(PORTC,ADC1);
     clr_bit(PORTC,ADC2);                            // disables pull-up for adcs pins
-    DDRC    =   0b00000000;                         // all adcs as inputs
+    DDRC    &=  ~((1 << ADC0) | (1 << ADC1) | (1 << ADC2)); // adcs as inputs
     set_bit(DIDR0,ADC0);
     set_bit(DIDR0,ADC1);
     set_bit(DIDR0,ADC2);                            // ADC0 to ADC2 as adc (digital disable)
@@ -47,6 +203,17 @@ void adc_init(void)
             | (1 << ADTS0);
 
     adc_select_channel(ADC0);                       // Choose admux
+#ifdef ADC_NR_ON
+    // started one at a time by sleep_task()
+    ADCSRA  =   (1 << ADIE)                         // ADC Interrupt Enable
+            | (1 << ADEN)                           // ADC Enable
+            | (1 << ADPS2)                          // ADC Prescaller = 128;
+            | (1 << ADPS1)
+            | (1 << ADPS0);
+
+    TCCR0B  =   0;                                  // timer0 not needed
+    TIMSK0  &=  ~(1 << OCIE0A);
+#else
     ADCSRA  =   (1 << ADATE)                        // ADC Auto Trigger Enable
             | (1 << ADIE)                           // ADC Interrupt Enable
             | (1 << ADEN)                           // ADC Enable
@@ -87,6 +254,7 @@ void adc_init(void)
 
 
     TIMSK0 |=   (1 << OCIE0A);                      // Ativa a interrupcao na igualdade de comparação do TC0 com OCR0A
+#endif // ADC_NR_ON
 
 }
 
@@ -95,33 +263,59 @@ void adc_init(void)
  */
 ISR(ADC_vect)
 {
+#ifdef ADC_NR_ON
+    adc.converted = 1;
+#endif
 
 #ifdef FAKE_ADC_ON
-    adc.channel[adc.select].sum += FAKE_ADC;
+    uint16_t sample = FAKE_ADC;
 #else // FAKE_ADC_ON
     #ifdef ADC_8BITS
-    adc.channel[adc.select].sum += ADCH;
+    uint16_t sample = ADCH;
     #else // ADC_8BITS
-    adc.channel[adc.select].sum += ADC;
+    uint16_t sample = ADC;
     #endif // ADC_8BITS
 #endif // FAKE_ADC_ON
 
+#ifdef ADC_CAL_ON
+    if(adc.select >= ADC_BANDGAP){
+        adc.select = adc_calibrate(sample);
+        adc_select_channel(adc.select);
+        return;
+    }
+#endif
+
+    adc.channel[adc.select].sum += sample;
+
     if(++adc.channel[adc.select].samples >= ADC_AVG_SIZE_10){
+#ifdef ADC_CAL_ON
+        adc.channel[adc.select].avg = adc_correct(adc.channel[adc.select].sum);
+#else
         adc.channel[adc.select].avg = adc.channel[adc.select].sum >> ADC_AVG_SIZE_2;
+#endif
 
         adc.channel[adc.select].samples = adc.channel[adc.select].sum = 0;
         adc.ready = 1;
+#ifdef ADC_CMP_ON
+        adc_compare(adc.select, adc.channel[adc.select].avg);
+#endif
+#ifdef WATCHDOG_ON
+        wdt_checkin(WDT_TASK_ADC);
+#endif
 
         #ifdef VERBOSE_ON_ADC
-        VERBOSE_MSG_ADC( usart_send_string("adc:") );
-        VERBOSE_MSG_ADC( usart_send_uint16(adc.select) );
-        VERBOSE_MSG_ADC( usart_send_char(':') );
-        VERBOSE_MSG_ADC( usart_send_uint16(adc.channel[adc.select].avg) );
-        VERBOSE_MSG_ADC( usart_send_char('\n') );
+        VERBOSE_MSG_ADC( LOG_FMT("adc:%05u:%05u\n", adc.select, adc.channel[adc.select].avg) );
         #endif
     }
     if(++adc.select > ADC_LAST_CHANNEL){
         adc.select = ADC0;             // recycles
+#ifdef ADC_CAL_ON
+        if(++adc.cal.cycle >= ADC_CAL_PERIOD){
+            adc.cal.cycle = 0;
+            adc.cal.settle = ADC_CAL_SETTLE;
+            adc.select = ADC_BANDGAP;
+        }
+#endif
     }
 
         adc_select_channel(adc.select);
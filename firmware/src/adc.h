@@ -6,6 +6,15 @@
  * @brief This module implements a simple ADC using a state machine to mux
  * between the adc channels.
  *
+ * With ADC_CAL_ON, every ADC_CAL_PERIOD cycles the sequencer also converts
+ * the 1.1V bandgap and the GND channels. Their filtered readings give an
+ * offset and a gain (Q12) that bring the averages back to what they would be
+ * with AVcc at ADC_CAL_VCC_MV, so the thresholds do not move with the supply.
+ *
+ * With ADC_LUT_ON, adc_value() converts an average to physical units through
+ * the channel table in adc_lut.h (see lib/lut.h), generated from calibration
+ * CSVs by tools/adc_lut.py. Channels without a table return the average.
+ *
  */
 
 #ifndef _ADC_H_
@@ -13,11 +22,15 @@
 
 #include "avr/io.h"
 #include "avr/interrupt.h"
+#include "util/atomic.h"
 #include "conf.h"
 #include "dbg_vrb.h"
 #include "usart.h"
 #include "../lib/bit_utils.h"
 #include "../lib/log2.h"
+#ifdef WATCHDOG_ON
+#include "watchdog.h"
+#endif
 
 // Equations for mode 2 (CTC with TOP OCR2A)
 // Note the resolution. For example.. at 150hz, ICR1 = PWM_TOP = 159, so it
@@ -27,26 +40,99 @@
 #define ADC_TIMER_TOP           ((F_CPU/(2*ADC_TIMER_PRESCALER))/(ADC_TIMER_FREQUENCY) -1)
 
 typedef enum adc_channels{
-    ADC0, ADC1 ,ADC2, ADC3, ADC4, ADC5
+    ADC0, ADC1 ,ADC2, ADC3, ADC4, ADC5,
+    ADC_BANDGAP = 14,                       //<! 1.1V internal reference
+    ADC_GND = 15,                           //<! 0V
 } adc_channels_t;                           //*< the adc_channel type
 
+#ifdef ADC_8BITS
+#define ADC_MAX                 255
+#define ADC_BITS                8
+#else
+#define ADC_MAX                 1023
+#define ADC_BITS                10
+#endif
+
 #define ADC_LAST_CHANNEL ADC2
 
+#if defined(ADC_NR_ON) && !defined(SLEEP_ON)
+#error "ADC_NR_ON needs SLEEP_ON: the conversions are started by sleep_task()"
+#endif
+
+// a conversion is 13 adc clocks (prescaler 128) plus, on average, half a
+// clock to synchronize its start
+#define ADC_CONVERSION_CYCLES   ((13 * 128) + 64)
+
 typedef struct{
     uint32_t sum;
     uint16_t avg;
     uint16_t samples;
 } adc_channel_t;
 
+#ifdef ADC_CAL_ON
+#define ADC_CAL_GAIN_Q          12
+#define ADC_CAL_GAIN_ONE        (1 << ADC_CAL_GAIN_Q)
+#define ADC_CAL_GAIN_MIN        (ADC_CAL_GAIN_ONE - ADC_CAL_GAIN_ONE / 4)   //<! -25%
+#define ADC_CAL_GAIN_MAX        (ADC_CAL_GAIN_ONE + ADC_CAL_GAIN_ONE / 4)   //<! +25%
+// bandgap reading expected at ADC_CAL_VCC_MV, in Q(ADC_CAL_FILTER_2)
+#define ADC_CAL_BANDGAP_NOMINAL \
+    ((uint16_t)((((uint32_t)(ADC_CAL_BANDGAP_MV) * ((ADC_MAX) + 1)) << (ADC_CAL_FILTER_2)) / (ADC_CAL_VCC_MV)))
+
+#if ADC_CAL_FILTER_2 > 6
+#error "ADC_CAL_FILTER_2 overflows the 16-bit estimates"
+#endif
+
+typedef struct{
+    uint16_t bandgap;                       //<! filtered bandgap reading, Q(ADC_CAL_FILTER_2)
+    uint16_t gnd;                           //<! filtered gnd reading, Q(ADC_CAL_FILTER_2)
+    uint16_t gain;                          //<! Q(ADC_CAL_GAIN_Q)
+    uint16_t offset;                        //<! gnd reading times ADC_AVG_SIZE_10
+    uint8_t cycle;                          //<! channel cycles since the last calibration
+    uint8_t settle;                         //<! bandgap conversions still to discard
+    uint8_t rejects;                        //<! gains out of ADC_CAL_GAIN_MIN..MAX
+} adc_cal_t;
+#endif
+
+#ifdef ADC_CMP_ON
+#ifndef ADC_CMP_POT_CHANNEL
+#error "ADC_CMP_ON needs ADC_CMP_POT_CHANNEL, the adc channel of the throttle pot"
+#endif
+#define ADC_CMP_OFF_LOW         0           //<! a low threshold that never trips
+#define ADC_CMP_OFF_HIGH        0xFFFF      //<! a high threshold that never trips
+
+typedef struct{
+    uint16_t low;                           //<! below it sets the low bit
+    uint16_t high;                          //<! above it sets the high bit
+    uint8_t hysteresis;                     //<! to clear them again
+} adc_cmp_t;
+#endif
+
 typedef struct adc{
     adc_channel_t channel[ADC_LAST_CHANNEL+1];
     adc_channels_t select;
     uint8_t ready;
+#ifdef ADC_NR_ON
+    uint8_t converted;                      //<! set by every conversion, see sleep.h
+#endif
+#ifdef ADC_CAL_ON
+    adc_cal_t cal;
+#endif
+#ifdef ADC_CMP_ON
+    uint8_t low;                            //<! bitmap of channels below their low threshold
+    uint8_t high;                           //<! bitmap of channels above their high threshold
+    uint8_t events;                         //<! channels whose low or high bit changed
+#endif
 } adc_t;
 
 extern volatile adc_t adc;
 
 uint8_t adc_select_channel(adc_channels_t __ch);
 void adc_init(void);
+#ifdef ADC_CMP_ON
+uint8_t adc_take_events(void);
+#endif
+#ifdef ADC_LUT_ON
+uint16_t adc_value(adc_channels_t ch);
+#endif
 
 #endif /* ifndef _ADC_H_ */
@@ -0,0 +1,34 @@
+// ----------------------------------------------------------------------------
+/* adc linearisation tables, generated by tools/adc_lut.py:
+ *
+ *  ./tools/adc_lut.py --bits 8 --points 17 ADC1=tools/cal/motor_ramp_pot.csv ADC2=tools/cal/mcc_power_pot.csv -o src/adc_lut.h
+ *
+ * Only included by adc.c.
+ */
+// ----------------------------------------------------------------------------
+
+#ifndef ADC_LUT_H
+#define ADC_LUT_H
+
+#include "../lib/lut.h"
+
+#define ADC_LUT_BITS            8
+#define ADC_LUT_SEGMENTS_2      4
+
+// tools/cal/motor_ramp_pot.csv
+static const uint16_t adc_lut_adc1[LUT_SIZE(ADC_LUT_SEGMENTS_2)] PROGMEM = {
+        0,    63,   125,   188,   251,   314,   376,   439,
+      502,   565,   627,   690,   753,   816,   878,   941,
+     1004,
+};
+#define ADC_LUT_ADC1              adc_lut_adc1
+
+// tools/cal/mcc_power_pot.csv
+static const uint16_t adc_lut_adc2[LUT_SIZE(ADC_LUT_SEGMENTS_2)] PROGMEM = {
+        0,    63,   125,   188,   251,   314,   376,   439,
+      502,   565,   627,   690,   753,   816,   878,   941,
+     1004,
+};
+#define ADC_LUT_ADC2              adc_lut_adc2
+
+#endif // ADC_LUT_H
@@ -0,0 +1,227 @@
+#include "anim.h"
+#include "machine.h"
+
+anim_player_t anim;
+
+enum anim_colours{
+    ANIM_BLACK, ANIM_RED, ANIM_DIM_RED, ANIM_AMBER, ANIM_DIM_AMBER, ANIM_GREEN, ANIM_DIM_GREEN,
+};
+
+/**
+ * @brief status bar colours, kept dim.
+ */
+static const ws2812_grb_t anim_palette[] PROGMEM = {
+    //                      g   r   b
+    [ANIM_BLACK]        = { 0,  0,  0},
+    [ANIM_RED]          = { 0,  64, 0},
+    [ANIM_DIM_RED]      = { 0,  8,  0},
+    [ANIM_AMBER]        = { 24, 64, 0},
+    [ANIM_DIM_AMBER]    = { 3,  8,  0},
+    [ANIM_GREEN]        = { 64, 0,  0},
+    [ANIM_DIM_GREEN]    = { 8,  0,  0},
+};
+
+static const uint8_t anim_off_code[] PROGMEM = {
+    ANIM_KEY(1), ANIM_RUN(16, ANIM_BLACK),
+    ANIM_END
+};
+
+// a green bar filling up
+static const uint8_t anim_charging_code[] PROGMEM = {
+    ANIM_KEY(1), ANIM_RUN(16, ANIM_DIM_GREEN), ANIM_HOLD(4),
+    ANIM_DELTA(1), ANIM_SET(0, ANIM_GREEN), ANIM_HOLD(2),
+    ANIM_DELTA(1), ANIM_SET(1, ANIM_GREEN), ANIM_HOLD(2),
+    ANIM_DELTA(1), ANIM_SET(2, ANIM_GREEN), ANIM_HOLD(2),
+    ANIM_DELTA(1), ANIM_SET(3, ANIM_GREEN), ANIM_HOLD(2),
+    ANIM_DELTA(1), ANIM_SET(4, ANIM_GREEN), ANIM_HOLD(2),
+    ANIM_DELTA(1), ANIM_SET(5, ANIM_GREEN), ANIM_HOLD(2),
+    ANIM_DELTA(1), ANIM_SET(6, ANIM_GREEN), ANIM_HOLD(2),
+    ANIM_DELTA(1), ANIM_SET(7, ANIM_GREEN), ANIM_HOLD(12),
+    ANIM_LOOP
+};
+
+// an amber dot with a tail going back and forth
+static const uint8_t anim_contactor_code[] PROGMEM = {
+    ANIM_KEY(2), ANIM_RUN(1, ANIM_AMBER), ANIM_RUN(16, ANIM_BLACK), ANIM_HOLD(1),
+    ANIM_DELTA(2), ANIM_SET(0, ANIM_DIM_AMBER), ANIM_SET(1, ANIM_AMBER), ANIM_HOLD(1),
+    ANIM_DELTA(3), ANIM_SET(0, ANIM_BLACK), ANIM_SET(1, ANIM_DIM_AMBER), ANIM_SET(2, ANIM_AMBER), ANIM_HOLD(1),
+    ANIM_DELTA(3), ANIM_SET(1, ANIM_BLACK), ANIM_SET(2, ANIM_DIM_AMBER), ANIM_SET(3, ANIM_AMBER), ANIM_HOLD(1),
+    ANIM_DELTA(3), ANIM_SET(2, ANIM_BLACK), ANIM_SET(3, ANIM_DIM_AMBER), ANIM_SET(4, ANIM_AMBER), ANIM_HOLD(1),
+    ANIM_DELTA(3), ANIM_SET(3, ANIM_BLACK), ANIM_SET(4, ANIM_DIM_AMBER), ANIM_SET(5, ANIM_AMBER), ANIM_HOLD(1),
+    ANIM_DELTA(3), ANIM_SET(4, ANIM_BLACK), ANIM_SET(5, ANIM_DIM_AMBER), ANIM_SET(6, ANIM_AMBER), ANIM_HOLD(1),
+    ANIM_DELTA(3), ANIM_SET(5, ANIM_BLACK), ANIM_SET(6, ANIM_DIM_AMBER), ANIM_SET(7, ANIM_AMBER), ANIM_HOLD(1),
+    ANIM_DELTA(3), ANIM_SET(7, ANIM_DIM_AMBER), ANIM_SET(6, ANIM_AMBER), ANIM_SET(5, ANIM_BLACK), ANIM_HOLD(1),
+    ANIM_DELTA(3), ANIM_SET(7, ANIM_BLACK), ANIM_SET(6, ANIM_DIM_AMBER), ANIM_SET(5, ANIM_AMBER), ANIM_HOLD(1),
+    ANIM_DELTA(3), ANIM_SET(6, ANIM_BLACK), ANIM_SET(5, ANIM_DIM_AMBER), ANIM_SET(4, ANIM_AMBER), ANIM_HOLD(1),
+    ANIM_DELTA(3), ANIM_SET(5, ANIM_BLACK), ANIM_SET(4, ANIM_DIM_AMBER), ANIM_SET(3, ANIM_AMBER), ANIM_HOLD(1),
+    ANIM_DELTA(3), ANIM_SET(4, ANIM_BLACK), ANIM_SET(3, ANIM_DIM_AMBER), ANIM_SET(2, ANIM_AMBER), ANIM_HOLD(1),
+    ANIM_DELTA(3), ANIM_SET(3, ANIM_BLACK), ANIM_SET(2, ANIM_DIM_AMBER), ANIM_SET(1, ANIM_AMBER), ANIM_HOLD(1),
+    ANIM_DELTA(3), ANIM_SET(2, ANIM_BLACK), ANIM_SET(1, ANIM_DIM_AMBER), ANIM_SET(0, ANIM_AMBER), ANIM_HOLD(1),
+    ANIM_LOOP
+};
+
+// the whole bar blinking red
+static const uint8_t anim_error_code[] PROGMEM = {
+    ANIM_KEY(1), ANIM_RUN(16, ANIM_RED), ANIM_HOLD(6),
+    ANIM_KEY(1), ANIM_RUN(16, ANIM_DIM_RED), ANIM_HOLD(6),
+    ANIM_LOOP
+};
+
+const anim_t anim_off PROGMEM           = {anim_palette, anim_off_code};
+const anim_t anim_charging PROGMEM      = {anim_palette, anim_charging_code};
+const anim_t anim_contactor PROGMEM     = {anim_palette, anim_contactor_code};
+const anim_t anim_error PROGMEM         = {anim_palette, anim_error_code};
+
+/**
+ * @brief sets a led of the frame buffer to a palette colour.
+ */
+static inline void anim_paint(uint8_t n, uint8_t colour)
+{
+    ws2812_grb_t c;
+
+    memcpy_P(&c, &anim.palette[colour], sizeof(c));
+    ws2812_set(n, c.r, c.g, c.b);
+}
+
+/**
+ * @brief decodes a keyframe of n runs.
+ */
+static void anim_key(uint8_t n)
+{
+    uint8_t led = 0, run = 0;
+
+    while(n--){
+        run = pgm_read_byte(anim.pc++);
+        for(uint8_t c = (run >> 4) + 1; c && led < WS2812_LEDS; c--)
+            anim_paint(led++, run & 0x0F);
+    }
+
+    while(led < WS2812_LEDS)                        // too short: last colour
+        anim_paint(led++, run & 0x0F);
+}
+
+/**
+ * @brief decodes a delta frame of n changes.
+ */
+static void anim_delta(uint8_t n)
+{
+    while(n--){
+        uint8_t led = pgm_read_byte(anim.pc++);
+        uint8_t colour = pgm_read_byte(anim.pc++);
+        if(led < WS2812_LEDS) anim_paint(led, colour);
+    }
+}
+
+void anim_init(void)
+{
+    anim.anim = NULL;
+    anim.pc = NULL;
+    anim.cost.decode = anim.cost.decode_max = anim.cost.rows = 0;
+    anim.cost.send = anim.cost.send_max = 0;
+    anim_play(&anim_off);
+}
+
+/**
+ * @brief starts an animation on the next tick. Nothing happens if it is
+ * already playing, so it can be called on every change.
+ */
+void anim_play(const anim_t *a)
+{
+    anim_t copy;
+
+    if(anim.anim == a) return;
+
+    memcpy_P(&copy, a, sizeof(copy));
+    anim.anim = a;
+    anim.palette = copy.palette;
+    anim.code = anim.pc = copy.code;
+    anim.hold = 0;
+
+    timer_start(TIMER_JOB_ANIM, 0, ANIM_TICKS);
+}
+
+/**
+ * @brief picks the animation for the system flags.
+ * @param flags is system_flags.all__
+ */
+void anim_select(uint16_t flags)
+{
+    if(flags & (1 << SYSTEM_FLAG_MOTOR_ERROR))
+        anim_play(&anim_error);
+    else if(flags & (1 << SYSTEM_FLAG_MOTOR_WAITING_CONTACTOR))
+        anim_play(&anim_contactor);
+    else if(flags & (1 << SYSTEM_FLAG_BOAT_CHARGING))
+        anim_play(&anim_charging);
+    else
+        anim_play(&anim_off);
+}
+
+/**
+ * @brief decodes and sends one row, measuring the ticks it took.
+ */
+void anim_task(void)
+{
+    uint8_t row = 0;
+
+    if(!timer_take(TIMER_JOB_ANIM)) return;
+
+    if(anim.hold){
+        anim.hold--;
+        return;
+    }
+
+    uint16_t t0 = ANIM_CLOCK();
+
+    // bounded, so a code without frames can not hang the main loop
+    for(uint8_t i = 0; i < ANIM_MAX_OPS && anim.pc && !row; i++){
+        uint8_t op = pgm_read_byte(anim.pc++);
+
+        switch(op & ANIM_OP_MASK){
+            case ANIM_OP_KEY:
+                anim_key(op & 0x1F);
+                row = 1;
+                break;
+            case ANIM_OP_DELTA:
+                anim_delta(op & 0x1F);
+                row = 1;
+                break;
+            case ANIM_OP_HOLD:
+                anim.hold = op & 0x1F;
+                if(anim.hold) anim.hold--;          // this tick is the first one
+                return;
+            case ANIM_OP_LOOP:
+                anim.pc = anim.code;
+                break;
+            default:                                // ANIM_END
+                anim.pc = NULL;
+                break;
+        }
+    }
+
+    // a hold right after the row starts with the tick that shows it
+    if(row && anim.pc){
+        uint8_t op = pgm_read_byte(anim.pc);
+
+        if((op & ANIM_OP_MASK) == ANIM_OP_HOLD){
+            anim.pc++;
+            anim.hold = op & 0x1F;
+            if(anim.hold) anim.hold--;
+        }
+    }
+
+    if(!anim.pc) timer_stop(TIMER_JOB_ANIM);        // no more ticks needed
+    if(!row) return;
+
+    uint16_t t1 = ANIM_CLOCK();
+
+    ws2812_wait();                                  // not a cost of this row
+    uint16_t t2 = ANIM_CLOCK();
+    ws2812_show();
+    uint16_t t3 = ANIM_CLOCK();
+
+    anim.cost.decode = ANIM_CLOCK_US(t0, t1);
+    if(anim.cost.decode > anim.cost.decode_max) anim.cost.decode_max = anim.cost.decode;
+    anim.cost.send = ANIM_CLOCK_US(t2, t3);
+    if(anim.cost.send > anim.cost.send_max) anim.cost.send_max = anim.cost.send;
+    anim.cost.rows++;
+}
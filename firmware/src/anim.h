@@ -0,0 +1,128 @@
+/**
+ * @file anim.h
+ *
+ * @defgroup ANIM Strip Animation Module
+ *
+ * @brief Plays animations stored in flash on the WS2812 strip.
+ *
+ * An animation is a palette of up to 16 colours and a code of keyframes and
+ * delta frames. Each tick of TIMER_JOB_ANIM decodes one row (one frame)
+ * straight into the ws2812 frame buffer and sends it, so the RAM used does
+ * not depend on the length of the animation and the work per tick is
+ * bounded by the largest row. The time spent decoding each row and sending
+ * it are kept apart in anim.cost, in us from timer1 (0.5 us) when LED_ON,
+ * leaving out the wait for the latch of the previous frame.
+ *
+ * The code is a sequence of the following instructions:
+ *
+ *  - ANIM_KEY(n):          a keyframe of n runs (1 to 31) follows
+ *  - ANIM_RUN(c, p):       c leds (1 to 16) of palette colour p
+ *  - ANIM_DELTA(n):        a delta frame of n changes (1 to 31) follows
+ *  - ANIM_SET(l, p):       led l to palette colour p
+ *  - ANIM_HOLD(n):         keeps the frame for n ticks (1 to 31), counting
+ *                          the tick that showed it when it follows a frame
+ *  - ANIM_LOOP:            plays again from the start
+ *  - ANIM_END:             stops, keeping the last frame
+ *
+ * Runs past the end of the strip are clipped and a keyframe that is too
+ * short repeats its last colour, so the animations do not depend on
+ * WS2812_LEDS. Changes to leds past the end are ignored.
+ *
+ * A frame shows for one tick, or for n ticks when ANIM_HOLD(n) follows it,
+ * so the blink below is 10 ticks on and 10 ticks off.
+ *
+ * @code
+ *  static const ws2812_grb_t blink_palette[] PROGMEM = { {0, 0, 0}, {0, 64, 0} };
+ *  static const uint8_t blink_code[] PROGMEM = {
+ *      ANIM_KEY(1), ANIM_RUN(16, 1), ANIM_HOLD(10),
+ *      ANIM_KEY(1), ANIM_RUN(16, 0), ANIM_HOLD(10),
+ *      ANIM_LOOP
+ *  };
+ *  const anim_t anim_blink PROGMEM = { blink_palette, blink_code };
+ *  anim_play(&anim_blink);
+ * @endcode
+ *
+ */
+
+#ifndef ANIM_H
+#define ANIM_H
+
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+
+#include "conf.h"
+#include "timer.h"
+#include "ws2812.h"
+#ifdef LED_ON
+#include "led.h"
+#endif
+#include "../lib/bit_utils.h"
+
+#ifndef WS2812_ON
+#error "ANIM_ON needs WS2812_ON"
+#endif
+
+#define ANIM_TICKS              TIMER_MS_TO_TICKS(ANIM_PERIOD_MS)
+#define ANIM_MAX_OPS            4           //<! control instructions per tick
+
+// instructions
+#define ANIM_OP_MASK            0xE0
+#define ANIM_OP_END             0x00
+#define ANIM_OP_KEY             0x20
+#define ANIM_OP_DELTA           0x40
+#define ANIM_OP_HOLD            0x60
+#define ANIM_OP_LOOP            0x80
+
+#define ANIM_KEY(n)             (ANIM_OP_KEY | ((n) & 0x1F))
+#define ANIM_RUN(c, p)          ((((c) - 1) << 4) | ((p) & 0x0F))
+#define ANIM_DELTA(n)           (ANIM_OP_DELTA | ((n) & 0x1F))
+#define ANIM_SET(l, p)          (l), ((p) & 0x0F)
+#define ANIM_HOLD(n)            (ANIM_OP_HOLD | ((n) & 0x1F))
+#define ANIM_LOOP               ANIM_OP_LOOP
+#define ANIM_END                ANIM_OP_END
+
+typedef struct{
+    const ws2812_grb_t *palette;            //<! in flash
+    const uint8_t *code;                    //<! in flash
+} anim_t;
+
+#ifdef LED_ON
+// timer1 runs the led pwm up to LED_TIMER_TOP, a span must be below one slot
+#define ANIM_CLOCK()            TCNT1
+#define ANIM_CLOCK_US(t0, t1)   ((uint16_t)((((t1) >= (t0) ? 0 : LED_TIMER_TOP + 1) + (t1) - (t0)) \
+                                    * LED_TIMER_PRESCALER / (F_CPU / 1000000UL)))
+#else
+#define ANIM_CLOCK()            timer_now()
+#define ANIM_CLOCK_US(t0, t1)   ((uint16_t)((t1) - (t0)) * TIMER_TICK_US)
+#endif
+
+typedef struct{
+    uint16_t decode;                        //<! us of the last row
+    uint16_t decode_max;
+    uint16_t send;                          //<! us of the last ws2812_show()
+    uint16_t send_max;
+    uint16_t rows;
+} anim_cost_t;
+
+typedef struct anim_player{
+    const anim_t *anim;                     //<! playing (flash), NULL if none
+    const ws2812_grb_t *palette;
+    const uint8_t *code;
+    const uint8_t *pc;                      //<! next instruction, NULL if stopped
+    uint8_t hold;                           //<! ticks left on ANIM_HOLD
+    anim_cost_t cost;
+} anim_player_t;
+
+extern anim_player_t anim;
+
+extern const anim_t anim_off;
+extern const anim_t anim_charging;
+extern const anim_t anim_contactor;
+extern const anim_t anim_error;
+
+void anim_init(void);
+void anim_play(const anim_t *a);
+void anim_select(uint16_t flags);
+void anim_task(void);
+
+#endif /* ifndef ANIM_H */
@@ -1,78 +1,261 @@
+#define LOG_MODULE LOG_MODULE_CAN_APP
 #include "../lib/CAN_PARSER/can_parser.h"
 #include "can_app.h"
 #include <string.h>
 
+#ifdef CAN_APP_START_ON
+#ifdef FAST_BOOT_ON
+static uint8_t can_app_started;
+#else
+static uint8_t can_app_started = 1;         // brought up by init()
+#endif
+
+/**
+ * @brief brings the controller up, one step per call. It is restarted if it
+ * does not answer. The static filters are written by can_start_poll() before
+ * it goes back to the normal mode.
+ * @return 1 when ready
+ */
+static uint8_t can_app_start_task(void)
+{
+    switch(can_start_poll()){
+        case CAN_START_READY:
+            VERBOSE_MSG_CAN_APP(LOG_FMT("CAN ready at %u ticks\n", timer_now()));
+            can_app_started = 1;
+            break;
+        case CAN_START_FAILED:
+            VERBOSE_MSG_ERROR(LOG_STR("CAN did not start, retrying\n"));
+            can_start(CAN_BITRATE, can_filter);
+            break;
+        default:
+            break;
+    }
+
+    return can_app_started;
+}
+
+/**
+ * @brief restarts the controller in the background, driven by
+ * can_app_task(). Nothing is done while a start is still running.
+ */
+void can_app_restart(void)
+{
+    if(!can_app_started) return;
+
+    can_app_started = 0;
+    can_start(CAN_BITRATE, can_filter);
+}
+
+/**
+ * @brief returns 1 when the controller is up, 0 while it is (re)starting.
+ */
+uint8_t can_app_ready(void)
+{
+    return can_app_started;
+}
+#endif
+
+static const uint8_t can_app_signature[CAN_APP_MODULES] PROGMEM = {
+    [CAN_APP_MODULE_MIC]    = CAN_SIGNATURE_MIC19,
+    [CAN_APP_MODULE_MAM]    = CAN_SIGNATURE_MAM19,
+    [CAN_APP_MODULE_MCS]    = CAN_SIGNATURE_MCS19,
+};
+
+static uint16_t can_app_rx_last[CAN_APP_MODULES];   //<! tick of the last frame
+static uint8_t can_app_timed_out;                   //<! bitmap of the silent modules
+
+/**
+ * @brief arms TIMER_JOB_CAN_TIMEOUT for the earliest module to time out.
+ */
+static void can_app_timeout_arm(void)
+{
+    uint16_t now = timer_now();
+    uint16_t next = CAN_APP_RX_TIMEOUT;
+    uint8_t armed = 0;
+
+    for(uint8_t i = 0; i < CAN_APP_MODULES; i++){
+        if(can_app_timed_out & (1 << i)) continue;
+
+        uint16_t left = CAN_APP_RX_TIMEOUT - (uint16_t)(now - can_app_rx_last[i]);
+        if(left < next) next = left;
+        armed = 1;
+    }
+
+    if(armed) timer_start(TIMER_JOB_CAN_TIMEOUT, next, 0);
+    else timer_stop(TIMER_JOB_CAN_TIMEOUT);
+}
+
+/**
+ * @brief a frame of the module arrived. The deadline is not moved: firing
+ * early only re-arms it for the next module to time out.
+ */
+static void can_app_rx_seen(can_app_modules_t module)
+{
+    can_app_rx_last[module] = timer_now();
+    can_app_timed_out &= ~(1 << module);
+
+    if(!timer_armed(TIMER_JOB_CAN_TIMEOUT)) can_app_timeout_arm();
+}
+
+/**
+ * @brief reports the modules that went silent, once each.
+ */
+static void can_app_timeout_task(void)
+{
+    if(!timer_take(TIMER_JOB_CAN_TIMEOUT)) return;
+
+    uint16_t now = timer_now();
+
+    for(uint8_t i = 0; i < CAN_APP_MODULES; i++){
+        if(can_app_timed_out & (1 << i)) continue;
+        if((uint16_t)(now - can_app_rx_last[i]) < CAN_APP_RX_TIMEOUT) continue;
+
+        can_app_timed_out |= (1 << i);
+        can_handle_timeout(pgm_read_byte(&can_app_signature[i]));
+    }
+
+    can_app_timeout_arm();
+}
+
+/**
+ * @brief enables the pin change interrupt on the MCP2515 INT pin, so a
+ * received frame wakes the machine (see machine_run()), and starts the rx
+ * timeouts.
+ */
+void can_app_init(void)
+{
+    uint16_t now = timer_now();
+
+    for(uint8_t i = 0; i < CAN_APP_MODULES; i++) can_app_rx_last[i] = now;
+    can_app_timed_out = 0;
+    can_app_timeout_arm();
+
+    set_bit(CAN_INT_PCMSK, CAN_INT_PCINT);
+    PCIFR = (1 << CAN_INT_PCIE);
+    set_bit(PCICR, CAN_INT_PCIE);
+}
+
+uint16_t can_app_filter_blackout;           //<! last filter reload, in ticks
+uint16_t can_app_filter_blackout_max;
+
+/**
+ * @brief changes the subscriptions at runtime. The controller is in
+ * configuration mode (nothing is received) only while the image is written.
+ * @param image is a filter set from can_build_filters()
+ * @return how long the controller could not receive, in ticks
+ */
+uint16_t can_app_load_filters(const uint8_t *image)
+{
+    uint16_t t0 = timer_now();
+
+    can_load_filters(image);
+
+    can_app_filter_blackout = timer_now() - t0;
+    if(can_app_filter_blackout > can_app_filter_blackout_max)
+        can_app_filter_blackout_max = can_app_filter_blackout;
+
+    VERBOSE_MSG_CAN_APP(LOG_FMT("CAN filters loaded, blackout < %u us\n",
+                (can_app_filter_blackout + 1) * TIMER_TICK_US));
+
+    return can_app_filter_blackout;
+}
+
 /**
  * @brief Manages the canbus application protocol
  */
 inline void can_app_task(void)
 {
+#ifdef WATCHDOG_ON
+    wdt_checkin(WDT_TASK_CAN);
+#endif
+
+#ifdef CAN_APP_START_ON
+    if(!can_app_started && !can_app_start_task()) return;
+#endif
+
+#ifdef CAN_HEALTH_ON
+    can_health_task();
+#endif
+
+    can_app_timeout_task();
     check_can();
 }
 
+#ifdef LATENCY_ON
+static uint8_t can_app_rx_valid;            //<! the frame being parsed has a stamp
+static uint16_t can_app_rx_stamp;           //<! its INT edge, see latency.h
+#endif
+
 void can_parse_mic_motor(can_msg_t *msg)
 {
     can_mic19_motor_msg_t *mic_motor = (can_mic19_motor_msg_t *)msg->raw;
 
-    system_flags.motor_switch_on = mic_motor->motor.motor_on;
-    system_flags.dms_switch = mic_motor->motor.dms_on;
-    system_flags.reverse_switch = mic_motor->motor.reverse;
+    can_app_rx_seen(CAN_APP_MODULE_MIC);
+
+    system_flags_write(SYSTEM_FLAGS_MIC_MOTOR_MASK,
+        ((uint16_t)mic_motor->motor.motor_on << SYSTEM_FLAG_MOTOR_SWITCH_ON)
+        | ((uint16_t)mic_motor->motor.dms_on << SYSTEM_FLAG_DMS_SWITCH)
+        | ((uint16_t)mic_motor->motor.reverse << SYSTEM_FLAG_REVERSE_SWITCH));
 }
 
 void can_parse_mic_mcs(can_msg_t *msg)
 {
     can_mic19_mcs_msg_t *mic_mcs = (can_mic19_mcs_msg_t *)msg->raw;
 
-    system_flags.boat_switch_on = mic_mcs->boat_on.boat_on;
+    can_app_rx_seen(CAN_APP_MODULE_MIC);
+
+    system_flags_write(1 << SYSTEM_FLAG_BOAT_SWITCH_ON,
+        (uint16_t)mic_mcs->boat_on.boat_on << SYSTEM_FLAG_BOAT_SWITCH_ON);
 }
 
+/**
+ * @brief system flags for each MAM state
+ */
+static const uint16_t can_mam_state_flags[] PROGMEM = {
+    [MAM_STATE_INITIALIZING]    = 0,
+    [MAM_STATE_CONTACTOR]       = (1 << SYSTEM_FLAG_MOTOR_WAITING_CONTACTOR),
+    [MAM_STATE_IDLE]            = (1 << SYSTEM_FLAG_MOTOR_IDLE),
+    [MAM_STATE_RUNNING]         = (1 << SYSTEM_FLAG_MOTOR_RUNNING),
+    [MAM_STATE_ERROR]           = (1 << SYSTEM_FLAG_MOTOR_ERROR),
+};
+
 void can_parse_mam_state(can_msg_t *msg)
 {
     can_mam19_state_msg_t *mam_state = (can_mam19_state_msg_t *)msg->raw;
 
-    switch (mam_state->state)
-    {
-    case MAM_STATE_INITIALIZING:
-        break;
-    case MAM_STATE_IDLE:
-        system_flags.motor_idle = 1;
-        system_flags.motor_running = 0;
-        system_flags.motor_waiting_contactor = 0;
-        system_flags.motor_error = 0;
-        break;
-    case MAM_STATE_RUNNING:
-        system_flags.motor_idle = 0;
-        system_flags.motor_running = 1;
-        system_flags.motor_waiting_contactor = 0;
-        system_flags.motor_error = 0;
-        break;
-    case MAM_STATE_CONTACTOR:
-        system_flags.motor_idle = 0;
-        system_flags.motor_running = 0;
-        system_flags.motor_waiting_contactor = 1;
-        system_flags.motor_error = 0;
-        break;
-    case MAM_STATE_ERROR:
-        system_flags.motor_idle = 0;
-        system_flags.motor_running = 0;
-        system_flags.motor_waiting_contactor = 0;
-        system_flags.motor_error = 1;
-        break;
-        
-    }
+    can_app_rx_seen(CAN_APP_MODULE_MAM);
+
+    // initializing keeps the last known state
+    if (mam_state->state == MAM_STATE_INITIALIZING
+        || mam_state->state > MAM_STATE_ERROR)
+        return;
+
+#ifdef LATENCY_ON
+    latency_frame(can_app_rx_valid, can_app_rx_stamp);
+#endif
+
+    system_flags_write(SYSTEM_FLAGS_MAM_MASK,
+        pgm_read_word(&can_mam_state_flags[mam_state->state]));
 }
 
 void can_parse_mam_motor(can_msg_t *msg)
 {
     can_mam19_motor_msg_t *mam_motor = (can_mam19_motor_msg_t *)msg->raw;
 
-    system_flags.pot_zero = (mam_motor->d < 6) ? 1 : 0;
+    can_app_rx_seen(CAN_APP_MODULE_MAM);
+
+#ifndef ADC_CMP_ON                              // else from the local pot
+    system_flags_write(1 << SYSTEM_FLAG_POT_ZERO,
+        (mam_motor->d < 6) ? (1 << SYSTEM_FLAG_POT_ZERO) : 0);
+#endif
 }
 
 void can_parse_mam_contactor(can_msg_t *msg)
 {
     can_mam19_contactor_msg_t *mam_contactor = (can_mam19_contactor_msg_t *)msg->raw;
 
+    can_app_rx_seen(CAN_APP_MODULE_MAM);
+
     // switch (mam_contactor->request)
     // {
     // case CONTACTOR_REQUEST_TURN_OFF:
@@ -89,12 +272,19 @@ void can_parse_mcs_start_stages(can_msg_t *msg)
 {
     can_mcs19_start_stages_msg_t *mcs_start = (can_mcs19_start_stages_msg_t *)msg->raw;
 
-    system_flags.boat_charging = mcs_start->charge_relay.charge_relay;
-    system_flags.boat_on = mcs_start->main_relay.main_relay;
+    can_app_rx_seen(CAN_APP_MODULE_MCS);
+
+    system_flags_write(SYSTEM_FLAGS_MCS_MASK,
+        ((uint16_t)mcs_start->charge_relay.charge_relay << SYSTEM_FLAG_BOAT_CHARGING)
+        | ((uint16_t)mcs_start->main_relay.main_relay << SYSTEM_FLAG_BOAT_ON));
 }
 
+/**
+ * @brief a module sent nothing for CAN_APP_RX_TIMEOUT_MS.
+ */
 void can_handle_timeout(uint8_t signature)
 {
+    VERBOSE_MSG_CAN_APP(LOG_FMT("CAN module %u timed out\n", signature));
 }
 
 /**
@@ -119,7 +309,8 @@ inline void check_can(void)
                          {CAN_SIGNATURE_MAM19, &CAN_TOPICS_NAME(mam), 0},
                          {CAN_SIGNATURE_MCS19, &CAN_TOPICS_NAME(mcs), 0});
 
-    if (can_check_message())
+    // bounded, INT stays low until both rx buffers are read
+    for (uint8_t n = 0; n < CAN_APP_RX_BURST && can_check_message(); n++)
     {
         can_t msg_temp;
         if (can_get_message(&msg_temp))
@@ -127,7 +318,25 @@ inline void check_can(void)
             can_msg_t msg;
             memcpy(msg.raw, msg_temp.data, sizeof(msg.raw));
             msg.id = msg_temp.id;
+#ifdef LATENCY_ON
+            can_app_rx_valid = latency_rx_take(&can_app_rx_stamp);
+#endif
             can_parser(&CAN_PARSER_NAME(mled_rx), &msg);
         }
     }
 }
+
+/**
+ * @brief MCP2515 INT pin change: wakes the machine for the frame, stamps it
+ * for the latency histogram and, as PCINT0 is shared, pushes the PORTB
+ * snapshot of the debounced pins.
+ */
+ISR(CAN_INT_vect)
+{
+#ifdef LATENCY_ON
+    latency_int();
+#endif
+#if defined(DEBOUNCE_PCINT_ON) && DEBOUNCE_PORTB_MASK
+    debounce_push(DEBOUNCE_PORTB, PINB);
+#endif
+}
@@ -18,9 +18,36 @@
 #include "machine.h"
 #include "usart.h"
 
+#if defined(FAST_BOOT_ON) || defined(RECOVERY_ON)
+#define CAN_APP_START_ON                    //<! non blocking (re)start, see can_start()
+#endif
+
+#define CAN_APP_RX_BURST        2           //<! frames drained per call, the MCP2515 rx buffers
+#define CAN_APP_RX_TIMEOUT      TIMER_MS_TO_TICKS(CAN_APP_RX_TIMEOUT_MS)
+
+// a frame is waiting in the MCP2515 while its INT is low
+#define can_app_rx_pending()    bit_is_clear(CAN_INT_PIN, CAN_INT)
+
+typedef enum can_app_modules{
+    CAN_APP_MODULE_MIC,
+    CAN_APP_MODULE_MAM,
+    CAN_APP_MODULE_MCS,
+    CAN_APP_MODULES,
+} can_app_modules_t;
+
+void can_app_init(void);
 void can_app_task(void);
+#ifdef CAN_APP_START_ON
+void can_app_restart(void);
+uint8_t can_app_ready(void);
+#endif
 
 void check_can(void);
+void can_handle_timeout(uint8_t signature);
+uint16_t can_app_load_filters(const uint8_t *image);
+
+extern uint16_t can_app_filter_blackout;
+extern uint16_t can_app_filter_blackout_max;
 
 #ifdef CAN_ON
 #define CAN_APP_SEND_STATE_CLK_DIV CAN_APP_SEND_STATE_FREQ
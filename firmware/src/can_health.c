@@ -0,0 +1,75 @@
+#define LOG_MODULE LOG_MODULE_CAN_HEALTH
+#include "can_health.h"
+
+can_health_t can_health;
+
+/**
+ * @brief maps the error flags to the confinement state.
+ */
+static uint8_t can_health_state(uint8_t flags)
+{
+    if(flags & CAN_ERROR_BUS_OFF)
+        return CAN_HEALTH_BUS_OFF;
+    if(flags & (CAN_ERROR_RX_PASSIVE | CAN_ERROR_TX_PASSIVE))
+        return CAN_HEALTH_PASSIVE;
+    if(flags & CAN_ERROR_WARNING)
+        return CAN_HEALTH_WARNING;
+    return CAN_HEALTH_ACTIVE;
+}
+
+/**
+ * @brief resets the statistics, keeping the current state.
+ */
+void can_health_clear(void)
+{
+    can_health.tec_min = can_health.rec_min = 0xFF;
+    can_health.tec_max = can_health.rec_max = 0;
+    for(uint8_t i = 0; i < CAN_HEALTH_STATES; i++) can_health.entered[i] = 0;
+    can_health.rx_overflows = can_health.samples = 0;
+}
+
+/**
+ * @brief starts the sampling job.
+ */
+void can_health_init(void)
+{
+    can_health.state = CAN_HEALTH_ACTIVE;
+    can_health_clear();
+
+    timer_start(TIMER_JOB_CAN_HEALTH, TIMER_MS_TO_TICKS(CAN_HEALTH_PERIOD_MS),
+                TIMER_MS_TO_TICKS(CAN_HEALTH_PERIOD_MS));
+}
+
+/**
+ * @brief takes a sample when due and updates the state and the statistics.
+ * Must only be called once the controller is configured.
+ */
+void can_health_task(void)
+{
+    can_error_state_t *e = &can_health.last;
+
+    if(!timer_take(TIMER_JOB_CAN_HEALTH)) return;
+
+    can_read_error_state(e);
+    can_health.samples++;
+
+    if(e->tx < can_health.tec_min) can_health.tec_min = e->tx;
+    if(e->tx > can_health.tec_max) can_health.tec_max = e->tx;
+    if(e->rx < can_health.rec_min) can_health.rec_min = e->rx;
+    if(e->rx > can_health.rec_max) can_health.rec_max = e->rx;
+    if(e->flags & CAN_ERROR_RX_OVERFLOW) can_health.rx_overflows++;
+
+    uint8_t state = can_health_state(e->flags);
+    if(state == can_health.state) return;
+
+    if(state > can_health.state){
+        VERBOSE_MSG_ERROR(LOG_FMT("CAN health %u -> %u (tec: %u rec: %u)\n",
+                    can_health.state, state, e->tx, e->rx));
+    }else{
+        VERBOSE_MSG_CAN_APP(LOG_FMT("CAN health %u -> %u (tec: %u rec: %u)\n",
+                    can_health.state, state, e->tx, e->rx));
+    }
+
+    can_health.entered[state]++;
+    can_health.state = state;
+}
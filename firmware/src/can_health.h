@@ -0,0 +1,48 @@
+/**
+ * @file can_health.h
+ *
+ * @defgroup CAN_HEALTH CAN Health Monitor Module
+ *
+ * @brief Samples the CAN error counters and tracks the error state.
+ *
+ * Every CAN_HEALTH_PERIOD_MS the TEC, REC and error flags are read with a
+ * single SPI transaction (see can_read_error_state()). The monitor keeps the
+ * confinement state (active, warning, passive, bus-off), the min/max of the
+ * counters and how many times each state was entered. The bus-off recovery
+ * itself is done by the recovery module, with its own backoff.
+ *
+ */
+
+#ifndef CAN_HEALTH_H
+#define CAN_HEALTH_H
+
+#include "conf.h"
+#include "dbg_vrb.h"
+#include "timer.h"
+#include "can.h"
+
+typedef enum can_health_states{
+    CAN_HEALTH_ACTIVE,
+    CAN_HEALTH_WARNING,
+    CAN_HEALTH_PASSIVE,
+    CAN_HEALTH_BUS_OFF,
+    CAN_HEALTH_STATES,
+} can_health_states_t;
+
+typedef struct can_health{
+    can_error_state_t last;                 //<! last sample
+    uint8_t state;
+    uint8_t tec_min, tec_max;
+    uint8_t rec_min, rec_max;
+    uint16_t entered[CAN_HEALTH_STATES];    //<! transitions into each state
+    uint16_t rx_overflows;                  //<! samples with an overflow flag
+    uint16_t samples;
+} can_health_t;
+
+extern can_health_t can_health;
+
+void can_health_init(void);
+void can_health_task(void);
+void can_health_clear(void);
+
+#endif /* ifndef CAN_HEALTH_H */
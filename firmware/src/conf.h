@@ -24,13 +24,17 @@
 #define VERBOSE_ON_INIT
 #define VERBOSE_ON_ERROR
 #define VERBOSE_ON_RELAY
+//#define LOG_TOKENIZED_ON                // binary logs, see tools/log_decode.py
 
 #define CAN_SIGNATURE_SELF              CAN_SIGNATURE_MIC19
 
 
 // MODULES ACTIVATION
 #define USART_ON
+#define CONSOLE_ON
 #define CAN_ON
+#define CAN_HEALTH_ON                   // samples tec/rec and the error state
+#define LATENCY_ON                      // can frame to led latency histogram
 #define CAN_DEPENDENT
 #define ADC_ON
 #define MACHINE_ON
@@ -38,13 +42,58 @@
 #define BUZZER_ON
 #define WATCHDOG_ON
 #define SLEEP_ON	
+#define FAST_BOOT_ON                    // no fixed delays, can starts in background
+#define PERSIST_ON                      // resumes from .noinit after a watchdog reset
+#define RECOVERY_ON                     // reinitializes the failing subsystem only
+#define DEBOUNCE_ON                     // vertical counter debouncing of the local inputs
+#define ADC_NR_ON                       // conversions in the adc noise reduction sleep
+#define WS2812_ON                       // addressable led strip (status bar)
+#define ANIM_ON                         // flash animations on the strip from the system flags
+//#define SR595_ON                      // mirrored indicators on chained 74HC595s (needs CAN_ON), board with the chain only
 //#define CHECK_MCS_ON
 
+#ifdef CONSOLE_ON
+#define CONSOLE_LINE_SIZE                   32
+#endif // CONSOLE_ON
+//#define LOG_MASK_DEFAULT                    0x01        //<! only errors, see log.h
+
+#ifdef WATCHDOG_ON
+#define WDT_TIMEOUT                         WDTO_120MS  //<! must fit the slowest check-in
+#endif // WATCHDOG_ON
+
+#ifdef RECOVERY_ON
+#define RECOVERY_BACKOFF_MIN_MS             5
+#define RECOVERY_BACKOFF_MAX_MS             1000
+#define RECOVERY_CAN_BUDGET                 8
+#define RECOVERY_CAN_BACKOFF_MS             20          //<! bus-off, above the mcp2515 own recovery
+#define RECOVERY_ADC_BUDGET                 4
+#define RECOVERY_ADC_BACKOFF_MS             50          //<! above one adc frame (40 ms with ADC_NR_ON)
+#define RECOVERY_USART_BUDGET               4
+#define RECOVERY_ADC_STALL_MS               100         //<! without an adc frame, not watched by the wdt
+#define RECOVERY_USART_ERRORS               16          //<! rx errors between checks
+#endif // RECOVERY_ON
+
+#ifdef PERSIST_ON
+#define PERSIST_CRUMBS                      8           //<! must be a power of two
+#endif // PERSIST_ON
+
 //PINS UPDATE FILTER CONFIGURATION
-#define BOAT_ON_TO_UPDATE 10
-#define MOTOR_ON_TO_UPDATE 10
-#define DEAD_MEN_TO_UPDATE 10
-#define EMERGENCY_ON_TO_UPDATE 10
+#ifdef DEBOUNCE_ON
+#define DEBOUNCE_PORTB_MASK                 0x00        //<! debounced pins, none on this board yet
+#define DEBOUNCE_PORTC_MASK                 0x00
+#define DEBOUNCE_PORTD_MASK                 0x00
+#define DEBOUNCE_PCINT_ON                               // edge driven instead of polled every machine tick
+#ifdef DEBOUNCE_PCINT_ON
+#define DEBOUNCE_SAMPLE_MS                  2           //<! sampling period while a port is moving
+#define DEBOUNCE_PORTB_SAMPLES              10          //<! stable samples to accept a change, 1..15
+#define DEBOUNCE_PORTC_SAMPLES              10
+#define DEBOUNCE_PORTD_SAMPLES              10
+#else
+#define DEBOUNCE_PORTB_SAMPLES              10          //<! stable machine ticks to accept a change, 1..15
+#define DEBOUNCE_PORTC_SAMPLES              10
+#define DEBOUNCE_PORTD_SAMPLES              10
+#endif
+#endif // DEBOUNCE_ON
 
 
 
@@ -56,12 +105,34 @@
 #define ADC_TIMER_PRESCALER                 8
 #define ADC_AVG_SIZE_2                      7                  // in base 2
 #define ADC_AVG_SIZE_10                     128                // in base 10
+#ifdef ADC_NR_ON
+#define ADC_NR_RX_QUIET_MS                  1000               //<! no adc sleep after a usart rx
+#endif
 
 #define ADC_AVG_VARIABLE_OVERFLOW_PROTECTION 4294967296/255 //32bit variable/8bit variable(maximum value of adc)
 
 #define POTENTIOMETER_LOW_TRIGGER 15
 #define POTENTIOMETER_HIGH_TRIGGER 240
 
+#define ADC_CAL_ON                                              // supply correction from the bandgap and gnd
+#ifdef ADC_CAL_ON
+#define ADC_CAL_PERIOD                      64                 //<! channel cycles between calibrations
+#define ADC_CAL_FILTER_2                    4                  //<! estimate time constant in calibrations, base 2
+#define ADC_CAL_SETTLE                      2                  //<! bandgap conversions discarded when selected
+#define ADC_CAL_VCC_MV                      5000               //<! supply the thresholds are tuned for
+#define ADC_CAL_BANDGAP_MV                  1100
+#endif // ADC_CAL_ON
+
+#define ADC_LUT_ON                                              // adc_value() through the tables in adc_lut.h
+
+// POT_ZERO comes from the MAM19 duty (throttle at zero) unless a board wires
+// the throttle pot to an adc channel and sets it here
+//#define ADC_CMP_ON                                            // hysteresis comparators on the averages
+#ifdef ADC_CMP_ON
+//#define ADC_CMP_POT_CHANNEL                 ADC0               //<! the throttle pot input, drives POT_ZERO
+#define ADC_CMP_HYSTERESIS                  4                  //<! in adc counts
+#endif // ADC_CMP_ON
+
 
 
 //#define FAKE_ADC_ON
@@ -73,11 +144,17 @@
 
 
 #ifdef MACHINE_ON
-// The machine frequency may not be superior of ADC_FREQUENCY/ADC_AVG_SIZE_10
-#define MACHINE_TIMER_FREQUENCY             120           //<! machine timer frequency in Hz
-#define MACHINE_TIMER_PRESCALER             1024          //<! machine timer prescaler
-#define MACHINE_CLK_DIVIDER_VALUE           ((uint64_t)(uint32_t)MACHINE_TIMER_FREQUENCY*(uint32_t)ADC_AVG_SIZE_10)/(ADC_FREQUENCY)           //<! machine_run clock divider
-#define MACHINE_FREQUENCY                   (MACHINE_TIMER_FREQUENCY)/(MACHINE_CLK_DIVIDER_VALUE)
+// The machine frequency may not be superior of ADC_FREQUENCY/ADC_AVG_SIZE_10.
+// It is only the supervision tick: the can frames (MCP2515 INT) and the
+// deadlines of the timer service wake the machine between the ticks.
+#if defined(DEBOUNCE_ON) && !defined(DEBOUNCE_PCINT_ON)
+#define MACHINE_TIMER_FREQUENCY             120           //<! also the debounce sampling
+#else
+#define MACHINE_TIMER_FREQUENCY             20            //<! machine tick frequency in Hz
+#endif
+#define MACHINE_TIMER_PRESCALER             1024          //<! tickless timer (timer2) prescaler
+#define MACHINE_FREQUENCY                   (MACHINE_TIMER_FREQUENCY)
+#define MACHINE_INFOS_FREQUENCY             60            //<! max print_infos() frequency in Hz
 
 // SCALE TO CONVERT ADC DEFINITIONS
 #define VSCALE                              (uint16_t)1000
@@ -139,15 +216,51 @@
 #define     LED_PIN                 PIND
 #define     LED_DDR                 DDRD
 #define     LED1                    PD6
+#ifdef SR595_ON
+// PD6 is the 74HC595 latch
+#define     cpl_led(y)
+#define     set_led(y)
+#define     clr_led(y)
+#else
 #define     cpl_led(y)              cpl_bit(LED_PORT, y)
 #define     set_led(y)              set_bit(LED_PORT, y)
 #define     clr_led(y)              clr_bit(LED_PORT, y)
+#endif
+
+// LED ENGINE CONFIGURATION
+#define     LED_PWM_FREQUENCY       125     //<! software pwm frame (and pattern step) rate in Hz
+#define     LED_TIMER_PRESCALER     8       //<! led engine timer (timer1) prescaler
 #else
 #define     cpl_led()               
 #define     set_led()               
 #define     clr_led()               
 #endif // LED_ON
 
+#ifdef WS2812_ON
+#define     WS2812_PORT             PORTB
+#define     WS2812_DDR              DDRB
+#define     WS2812                  PB2     //<! SPI SS, an output in master mode
+#define     WS2812_LEDS             8       //<! length of the strip
+
+#ifdef ANIM_ON
+#define     ANIM_PERIOD_MS          40      //<! one row per tick, 25 Hz
+#endif // ANIM_ON
+#endif // WS2812_ON
+
+#ifdef SR595_ON
+#define     SR595_LATCH_PORT        PORTD
+#define     SR595_LATCH_DDR         DDRD
+#define     SR595_LATCH             PD6     //<! was DMS (and LED1), now on the chain
+#define     SR595_CHIPS             2       //<! chained 74HC595s, 8 outputs each
+
+// chain outputs of the indicators that mirror a system flag, 8 * chip + Qn
+#define     SR595_BOAT_ON_SWITCH    0
+#define     SR595_MOTOR_ON_SWITCH   1
+#define     SR595_POT_ZERO          2
+#define     SR595_DMS               3
+#define     SR595_REVERSE_SWITCH    4
+#endif // SR595_ON
+
 #ifdef BUZZER_ON
 #define     BUZZER_PORT             PORTD
 #define     BUZZER_PIN              PIND
@@ -160,10 +273,22 @@
 
 #ifdef CAN_ON
 #define SPI_ON
+#define CAN_BITRATE                 BITRATE_500_KBPS    //<! BITRATE_CUSTOM: see tools/can_bittiming.py
 #define CAN_APP_SEND_STATE_FREQ     40//36000     //<! state msg frequency in Hz
 #define CAN_APP_SEND_MOTOR_FREQ     0//36000     //<! motor msg frequency in Hz
 #define CAN_APP_SEND_BOAT_FREQ      0//36000     //<! motor msg frequency in Hz
 #define CAN_APP_SEND_PUMPS_FREQ     4//36000     //<! motor msg frequency in Hz
+#define CAN_HEALTH_PERIOD_MS        50          //<! error counters sampling period
+#define CAN_APP_RX_TIMEOUT_MS       500         //<! without a frame of a module
+
+#define     CAN_CS_PORT             PORTB
+#define     CAN_CS                  PB0         //<! MCP2515 CS, see lib/avr-can-lib/src/config.h
+#define     CAN_INT_PIN             PINB
+#define     CAN_INT                 PB1         //<! MCP2515 INT, see lib/avr-can-lib/src/config.h
+#define     CAN_INT_PCMSK           PCMSK0
+#define     CAN_INT_PCINT           PCINT1
+#define     CAN_INT_PCIE            PCIE0
+#define     CAN_INT_vect            PCINT0_vect
 
 
 
@@ -0,0 +1,364 @@
+#define LOG_MODULE LOG_MODULE_CONSOLE
+#include "console.h"
+
+volatile console_t console;
+
+static void console_help(uint8_t argc, char **argv);
+static void console_log(uint8_t argc, char **argv);
+static void console_stats(uint8_t argc, char **argv);
+static void console_selftest(uint8_t argc, char **argv);
+#ifdef CAN_ON
+static void console_filter(uint8_t argc, char **argv);
+#endif
+#ifdef LATENCY_ON
+static void console_latency(uint8_t argc, char **argv);
+#endif
+#ifdef WS2812_ON
+static void console_strip(uint8_t argc, char **argv);
+#endif
+
+static const console_command_t console_commands[] PROGMEM = {
+    {"help",        &console_help},
+    {"log",         &console_log},
+    {"stats",       &console_stats},
+    {"selftest",    &console_selftest},
+#ifdef CAN_ON
+    {"filter",      &console_filter},
+#endif
+#ifdef LATENCY_ON
+    {"latency",     &console_latency},
+#endif
+#ifdef WS2812_ON
+    {"strip",       &console_strip},
+#endif
+};
+
+#define CONSOLE_COMMANDS    (sizeof(console_commands) / sizeof(console_command_t))
+
+/**
+ * @brief names of the log mask bits, in bit order.
+ */
+static const char console_log_modules[][8] PROGMEM = {
+    "error", "can", "adc", "pwm", "init", "machine",
+};
+
+#define CONSOLE_LOG_MODULES (sizeof(console_log_modules) / sizeof(console_log_modules[0]))
+
+/**
+ * @brief parses a hex number.
+ * @return 1 if the whole string is a valid number
+ */
+static uint8_t console_parse_hex(const char *s, uint16_t *value)
+{
+    *value = 0;
+    if(!*s) return 0;
+
+    for(; *s; s++){
+        char c = *s | 0x20;                         // lower case
+        *value <<= 4;
+        if(c >= '0' && c <= '9') *value |= c - '0';
+        else if(c >= 'a' && c <= 'f') *value |= c - 'a' + 10;
+        else return 0;
+    }
+    return 1;
+}
+
+static void console_help(uint8_t argc, char **argv)
+{
+    LOG_STR("help | log [mask | <module> on|off] | stats | selftest\n");
+#ifdef CAN_ON
+    LOG_STR("filter\n");
+#endif
+#ifdef LATENCY_ON
+    LOG_STR("latency [clear]\n");
+#endif
+#ifdef WS2812_ON
+    LOG_STR("strip <led|all> <rgb>\n");
+#endif
+    LOG_STR("modules: error can adc pwm init machine\n");
+}
+
+static void console_log(uint8_t argc, char **argv)
+{
+    uint16_t mask;
+
+    if(argc == 2){
+        if(!console_parse_hex(argv[1], &mask)){
+            LOG_STR("bad mask\n");
+            return;
+        }
+        log_mask = mask;
+    }else if(argc == 3){
+        uint8_t i;
+        for(i = 0; i < CONSOLE_LOG_MODULES; i++)
+            if(!strcmp_P(argv[1], console_log_modules[i])) break;
+
+        if(i == CONSOLE_LOG_MODULES){
+            LOG_STR("unknown module\n");
+            return;
+        }
+
+        if(!strcmp_P(argv[2], PSTR("on"))) set_bit(log_mask, i);
+        else if(!strcmp_P(argv[2], PSTR("off"))) clr_bit(log_mask, i);
+        else{
+            LOG_STR("use on or off\n");
+            return;
+        }
+    }
+
+    LOG_FMT("log mask: %02x\n", log_mask);
+}
+
+static void console_stats(uint8_t argc, char **argv)
+{
+#ifdef MACHINE_ON
+    LOG_FMT("state: %u errors: %u error flags: %02x system flags: %04x\n",
+            machine_fsm.state, total_errors, error_flags.all, system_flags.all__);
+
+    for(uint8_t i = 0; i < STATES; i++)
+        LOG_FMT("time in state %u: %u\n", i, machine_time_in_state[i]);
+
+    for(uint8_t i = 0; i < machine_fsm.trace_count; i++){
+        const fsm_trace_t *t = fsm_trace(&machine_fsm, i);
+        LOG_FMT("transition %u: %u -> %u after %u\n", i, t->from, t->to, t->elapsed);
+    }
+#endif
+
+#ifdef CAN_ON
+#ifdef CAN_HEALTH_ON
+    LOG_FMT("can state: %u tec: %u (%u..%u) rec: %u (%u..%u) samples: %u\n",
+            can_health.state, can_health.last.tx, can_health.tec_min, can_health.tec_max,
+            can_health.last.rx, can_health.rec_min, can_health.rec_max, can_health.samples);
+    LOG_FMT("can entered warning: %u passive: %u bus-off: %u overflows: %u\n",
+            can_health.entered[CAN_HEALTH_WARNING], can_health.entered[CAN_HEALTH_PASSIVE],
+            can_health.entered[CAN_HEALTH_BUS_OFF], can_health.rx_overflows);
+#else
+    can_error_register_t err = can_read_error_register();
+    LOG_FMT("can tec: %u rec: %u\n", err.tx, err.rx);
+#endif
+#endif
+
+#ifdef RECOVERY_ON
+    for(uint8_t i = 0; i < RECOVERY_SUBSYSTEMS; i++)
+        LOG_FMT("recovery %u: recoveries %u attempts %u\n", i,
+                recovery[i].recoveries, recovery[i].attempts);
+#endif
+
+#ifdef ADC_NR_ON
+    LOG_FMT("adc sleeps: %u idle: %u early wakes: %u\n",
+            sleep_stats.adc_sleeps, sleep_stats.idle_sleeps, sleep_stats.early_wakes);
+#endif
+
+#ifdef ANIM_ON
+    LOG_FMT("anim rows: %u decode: %u max %u send: %u max %u us\n",
+            anim.cost.rows, anim.cost.decode, anim.cost.decode_max,
+            anim.cost.send, anim.cost.send_max);
+#endif
+
+#ifdef SR595_ON
+    LOG_FMT("sr595 bursts: %u deferred: %u spi busy: %u\n",
+            sr595.bursts, sr595.deferred, spi_bus.busy);
+#endif
+
+#ifdef PERSIST_ON
+    LOG_FMT("reset cause: %02x warm: %u warm restarts: %u crumbs: %02x %02x %02x %02x\n",
+            persist.reset_cause, persist_warm, persist.warm_restarts,
+            persist_last_crumb(0), persist_last_crumb(1),
+            persist_last_crumb(2), persist_last_crumb(3));
+#endif
+
+    LOG_FMT("console overruns: %u log mask: %02x\n", console.overruns, log_mask);
+}
+
+static void console_selftest(uint8_t argc, char **argv)
+{
+    uint8_t fail = 0;
+
+#ifdef MACHINE_ON
+    uint16_t t0 = timer_now();
+    _delay_ms(2);
+    if((uint16_t)(timer_now() - t0) < TIMER_MS_TO_TICKS(1)){
+        LOG_STR("timer: FAIL\n");
+        fail = 1;
+    }else{
+        LOG_STR("timer: ok\n");
+    }
+#endif
+
+#ifdef ADC_ON
+    for(uint8_t i = 0; i <= ADC_LAST_CHANNEL; i++)
+#ifdef ADC_LUT_ON
+        LOG_FMT("adc%u: %u value: %u\n", i, adc.channel[i].avg, adc_value(i));
+#else
+        LOG_FMT("adc%u: %u\n", i, adc.channel[i].avg);
+#endif
+#ifdef ADC_CAL_ON
+    LOG_FMT("adc cal gain: %u offset: %u bandgap: %u gnd: %u rejects: %u\n",
+            adc.cal.gain, adc.cal.offset, adc.cal.bandgap, adc.cal.gnd, adc.cal.rejects);
+#endif
+#endif
+
+#ifdef CAN_ON
+    can_error_register_t err = can_read_error_register();
+    if(err.tx >= 128 || err.rx >= 128){             // error passive or worse
+        LOG_FMT("can: FAIL (tec: %u rec: %u)\n", err.tx, err.rx);
+        fail = 1;
+    }else{
+        LOG_STR("can: ok\n");
+    }
+#endif
+
+    if(fail) LOG_STR("selftest: FAIL\n");
+    else LOG_STR("selftest: ok\n");
+}
+
+#ifdef CAN_ON
+/**
+ * @brief reloads the boot filter set through the batch path, reporting the
+ * blackout.
+ */
+static void console_filter(uint8_t argc, char **argv)
+{
+    uint8_t image[CAN_FILTER_IMAGE_SIZE];
+
+    memcpy_P(image, can_filter, CAN_FILTER_IMAGE_SIZE);     // same layout
+    uint16_t ticks = can_app_load_filters(image);
+    LOG_FMT("filter: blackout < %u us (max %u ticks)\n",
+            (ticks + 1) * TIMER_TICK_US, can_app_filter_blackout_max);
+}
+#endif
+
+#ifdef WS2812_ON
+/**
+ * @brief sets one led of the strip, or all of them, to a 12-bit hex colour
+ * (e.g. f80 for orange) and sends the frame.
+ */
+static void console_strip(uint8_t argc, char **argv)
+{
+    uint16_t led, rgb;
+
+    if(argc != 3 || !console_parse_hex(argv[2], &rgb) || rgb > 0xFFF){
+        LOG_STR("usage: strip <led|all> <rgb>\n");
+        return;
+    }
+
+    // 4 to 8 bits per colour: 0xF becomes 0xFF
+    uint8_t r = ((rgb >> 8) & 0xF) * 17;
+    uint8_t g = ((rgb >> 4) & 0xF) * 17;
+    uint8_t b = (rgb & 0xF) * 17;
+
+    if(!strcmp(argv[1], "all")){
+        ws2812_fill(r, g, b);
+    }else if(console_parse_hex(argv[1], &led) && led < WS2812_LEDS){
+        ws2812_set(led, r, g, b);
+    }else{
+        LOG_FMT("strip: led 0 to %u\n", WS2812_LEDS - 1);
+        return;
+    }
+    ws2812_show();
+}
+#endif
+
+#ifdef LATENCY_ON
+/**
+ * @brief dumps the can to led latency histogram, in timer ticks.
+ */
+static void console_latency(uint8_t argc, char **argv)
+{
+    if(argc > 1 && !strcmp(argv[1], "clear")){
+        latency_clear();
+        return;
+    }
+
+    LOG_FMT("latency: %u samples, min %u max %u ticks of %u us\n",
+            latency.count, latency.count ? latency.min : 0, latency.max, TIMER_TICK_US);
+    for(uint8_t i = 0; i < LATENCY_BUCKETS; i++){
+        if(!latency.bucket[i]) continue;
+        LOG_FMT("  < 2^%u ticks: %u\n", i, latency.bucket[i]);
+    }
+}
+#endif
+
+/**
+ * @brief enables the receive interrupt. The usart must be initialized with
+ * the receiver on.
+ */
+void console_init(void)
+{
+    console.len = console.ready = console.overruns = 0;
+    set_bit(UCSR0B, RXCIE0);
+}
+
+/**
+ * @brief runs the command of a received line, if any.
+ */
+void console_task(void)
+{
+    char *argv[CONSOLE_MAX_ARGS];
+    uint8_t argc = 0;
+    char *s = (char *)console.line;
+
+    if(!console.ready) return;
+
+    while(*s && argc < CONSOLE_MAX_ARGS){
+        while(*s == ' ') *s++ = '\0';
+        if(!*s) break;
+        argv[argc++] = s;
+        while(*s && *s != ' ') s++;
+    }
+    *s = '\0';
+
+    if(argc){
+        uint8_t i;
+        for(i = 0; i < CONSOLE_COMMANDS; i++){
+            console_command_t cmd;
+            memcpy_P(&cmd, &console_commands[i], sizeof(cmd));
+            if(!strcmp(argv[0], cmd.name)){
+                cmd.handler(argc, argv);
+                break;
+            }
+        }
+        if(i == CONSOLE_COMMANDS) LOG_STR("unknown command, try help\n");
+    }
+
+    console.len = 0;
+    console.ready = 0;                              // releases the buffer
+}
+
+/**
+ * @brief collects a line. Chars received while a line waits to be handled
+ * are dropped.
+ */
+ISR(USART_RX_vect)
+{
+#ifdef RECOVERY_ON
+    // the error flags are only valid before UDR0 is read
+    if(UCSR0A & ((1 << FE0) | (1 << DOR0) | (1 << UPE0))){
+        (void)UDR0;
+        recovery_usart_errors++;
+        return;
+    }
+#endif
+    char c = UDR0;
+
+#ifdef ADC_NR_ON
+    // keeps the adc noise reduction sleep off while someone is typing
+    sleep_rx_stamp = timer_now();
+    sleep_rx_active = 1;
+#endif
+
+    if(console.ready){
+        console.overruns++;
+        return;
+    }
+
+    if(c == '\r' || c == '\n'){
+        if(!console.len) return;
+        console.line[console.len] = '\0';
+        console.ready = 1;
+    }else if(console.len < CONSOLE_LINE_SIZE - 1){
+        console.line[console.len++] = c;
+    }else{
+        console.overruns++;
+    }
+}
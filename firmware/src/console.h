@@ -0,0 +1,59 @@
+/**
+ * @file console.h
+ *
+ * @defgroup CONSOLE Console Module
+ *
+ * @brief Small command line over the usart.
+ *
+ * The receive interrupt only collects a line. The line is parsed and the
+ * command executed by console_task(), called from the main loop, so a slow
+ * command never blocks the interrupts.
+ *
+ * Commands:
+ *
+ *  - help:                         lists the commands
+ *  - log:                          shows the log mask
+ *  - log <mask>:                   sets the log mask (hex)
+ *  - log <module> <on|off>:        turns one module on or off
+ *  - stats:                        dumps the counters
+ *  - selftest:                     checks timer, adc and can
+ *
+ */
+
+#ifndef CONSOLE_H
+#define CONSOLE_H
+
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+#include <avr/interrupt.h>
+#include <util/delay.h>
+#include <string.h>
+
+#include "conf.h"
+#include "dbg_vrb.h"
+#include "usart.h"
+#include "machine.h"
+#include "../lib/bit_utils.h"
+
+#define CONSOLE_MAX_ARGS        3
+
+typedef struct console{
+    char line[CONSOLE_LINE_SIZE];
+    uint8_t len;
+    uint8_t ready;                          //<! a full line waits for console_task()
+    uint8_t overruns;                       //<! chars dropped
+} console_t;
+
+typedef void (*console_handler_t)(uint8_t argc, char **argv);
+
+typedef struct{
+    char name[10];
+    console_handler_t handler;
+} console_command_t;
+
+extern volatile console_t console;
+
+void console_init(void);
+void console_task(void);
+
+#endif /* ifndef CONSOLE_H */
@@ -9,6 +9,9 @@
 
 #ifndef DBG_VRB_H
 #define DBG_VRB_H
+
+#include <avr/pgmspace.h>
+#include "log.h"
     
 #ifdef VERBOSE_ON
 #define VERBOSE_MSG(x) x
@@ -17,37 +20,37 @@
 #endif
 
 #ifdef VERBOSE_ON_ERROR
-#define VERBOSE_MSG_ERROR(x) x
+#define VERBOSE_MSG_ERROR(x) do{ if(log_mask & LOG_MASK_ERROR){ x; } }while(0)
 #else
 #define VERBOSE_MSG_ERROR(x)
 #endif 
 
 #ifdef VERBOSE_ON_CAN_APP
-#define VERBOSE_MSG_CAN_APP(x) x
+#define VERBOSE_MSG_CAN_APP(x) do{ if(log_mask & LOG_MASK_CAN_APP){ x; } }while(0)
 #else
 #define VERBOSE_MSG_CAN_APP(x)
 #endif
 
 #ifdef VERBOSE_ON_ADC
-#define VERBOSE_MSG_ADC(x) x
+#define VERBOSE_MSG_ADC(x) do{ if(log_mask & LOG_MASK_ADC){ x; } }while(0)
 #else
 #define VERBOSE_MSG_ADC(x)
 #endif 
  
 #ifdef VERBOSE_ON_PWM
-#define VERBOSE_MSG_PWM(x) x
+#define VERBOSE_MSG_PWM(x) do{ if(log_mask & LOG_MASK_PWM){ x; } }while(0)
 #else
 #define VERBOSE_MSG_PWM(x)
 #endif 
  
 #ifdef VERBOSE_ON_INIT
-#define VERBOSE_MSG_INIT(x) x
+#define VERBOSE_MSG_INIT(x) do{ if(log_mask & LOG_MASK_INIT){ x; } }while(0)
 #else
 #define VERBOSE_MSG_INIT(x)
 #endif 
 
 #ifdef VERBOSE_ON_MACHINE
-#define VERBOSE_MSG_MACHINE(x) x
+#define VERBOSE_MSG_MACHINE(x) do{ if(log_mask & LOG_MASK_MACHINE){ x; } }while(0)
 #else
 #define VERBOSE_MSG_MACHINE(x)
 #endif 
@@ -65,6 +68,41 @@
 #define DEBUG1
 #endif
 
+// Logging helpers. LOG_STR keeps the literal in flash, so verbose messages do
+// not take any .data (SRAM) space. LOG_FMT takes a printf like format and
+// up to 16-bit arguments (see log.h).
+//usage:
+//VERBOSE_MSG_MACHINE(LOG_STR("bo_sw: "));
+//VERBOSE_MSG_ADC(LOG_FMT("adc%u: %u\n", ch, value));
+#ifdef LOG_TOKENIZED_ON
+// Each site becomes an id and its binary arguments. The format strings go to
+// the non-loaded `.logstr` section (the `;` comments out the flags that gcc
+// appends to the section directive), so they leave the flash as well.
+#define LOG_ID(n)               ((uint16_t)(((LOG_MODULE) << LOG_SITE_BITS) | ((n) & LOG_SITE_MASK)))
+#define LOG_RECORD_(id, f)      static const struct { uint16_t i; char s[sizeof(f)]; } log_record__     \
+                                __attribute__((used, section(".logstr,\"\",@progbits;"))) = {id, f}
+#define LOG_STR_(id, s)         do{ LOG_RECORD_(id, s); log_write(id, 0, 0); }while(0)
+#define LOG_FMT_(id, f, ...)    do{ LOG_RECORD_(id, f);                                                 \
+                                    const uint16_t log_args__[] = {__VA_ARGS__};                        \
+                                    log_write(id, log_args__, sizeof(log_args__) / sizeof(uint16_t));   \
+                                }while(0)
+#define LOG_STR(s)              LOG_STR_(LOG_ID(__COUNTER__), s)
+#define LOG_FMT(f, ...)         LOG_FMT_(LOG_ID(__COUNTER__), f, __VA_ARGS__)
+#define LOG_CHAR(c)             LOG_FMT("%c", (c))
+#define LOG_U8(n)               LOG_FMT("%03u", (n))
+#define LOG_U16(n)              LOG_FMT("%05u", (n))
+#define LOG_U32(n)              LOG_FMT("%010lu", (uint16_t)(n), (uint16_t)((uint32_t)(n) >> 16))
+#else
+#define LOG_STR(s)              usart_send_string_P(PSTR(s))
+#define LOG_FMT(f, ...)         do{ const uint16_t log_args__[] = {__VA_ARGS__};                        \
+                                    log_write_text(PSTR(f), log_args__, sizeof(log_args__) / sizeof(uint16_t)); \
+                                }while(0)
+#define LOG_CHAR(c)             usart_send_char(c)
+#define LOG_U8(n)               usart_send_uint8(n)
+#define LOG_U16(n)              usart_send_uint16(n)
+#define LOG_U32(n)              usart_send_uint32(n)
+#endif
+
 // https://stackoverflow.com/a/10791845/3850957
 //usage:
 //#pragma message "The value of ABC: " XSTR(ABC)
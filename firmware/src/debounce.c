@@ -0,0 +1,200 @@
+#include "debounce.h"
+
+debounce_port_t debounce[DEBOUNCE_PORTS];
+#ifdef DEBOUNCE_PCINT_ON
+volatile debounce_queue_t debounce_queue;
+uint8_t debounce_active;
+#endif
+
+// all ones in plane n if bit n of the threshold is set
+#define DEBOUNCE_PLANE(t, n)    (((t) >> (n)) & 1 ? 0xFF : 0x00)
+
+/**
+ * @brief one sample of a port. With constant mask and threshold it is a
+ * couple dozen instructions, independent of the number of pins.
+ * @return non-zero while some pin is still counting
+ */
+static inline uint8_t debounce_port(debounce_port_t *p, uint8_t pins,
+        const uint8_t mask, const uint8_t samples)
+{
+    uint8_t *c = p->count;
+    uint8_t diff = (pins ^ p->state) & mask;    // pins that want to toggle
+    uint8_t c0 = c[0], c1 = c[1], c2 = c[2];
+
+    // count up where they differ, clear where they agree
+    c[0] = ~c0 & diff;
+    c[1] = (c1 ^ c0) & diff;
+    c[2] = (c2 ^ (c1 & c0)) & diff;
+    c[3] = (c[3] ^ (c2 & c1 & c0)) & diff;
+
+    uint8_t hit = diff
+        & ~(c[0] ^ DEBOUNCE_PLANE(samples, 0)) & ~(c[1] ^ DEBOUNCE_PLANE(samples, 1))
+        & ~(c[2] ^ DEBOUNCE_PLANE(samples, 2)) & ~(c[3] ^ DEBOUNCE_PLANE(samples, 3));
+
+    p->state ^= hit;
+    p->events |= hit;
+#ifdef DEBOUNCE_PCINT_ON
+    if(hit) p->event_stamp = p->stamp;
+#endif
+    c[0] &= ~hit;
+    c[1] &= ~hit;
+    c[2] &= ~hit;
+    c[3] &= ~hit;
+
+    return diff & ~hit;
+}
+
+/**
+ * @brief starts every port from its current pins, without events.
+ */
+void debounce_init(void)
+{
+    debounce[DEBOUNCE_PORTB].state = PINB & DEBOUNCE_PORTB_MASK;
+    debounce[DEBOUNCE_PORTC].state = PINC & DEBOUNCE_PORTC_MASK;
+    debounce[DEBOUNCE_PORTD].state = PIND & DEBOUNCE_PORTD_MASK;
+
+    for(uint8_t i = 0; i < DEBOUNCE_PORTS; i++){
+        debounce[i].count[0] = debounce[i].count[1] = 0;
+        debounce[i].count[2] = debounce[i].count[3] = 0;
+        debounce[i].events = 0;
+    }
+
+#ifdef DEBOUNCE_PCINT_ON
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+        debounce_queue.head = debounce_queue.tail = 0;
+        debounce_active = 0;
+
+        PCMSK0 |= DEBOUNCE_PORTB_MASK;
+        PCMSK1 |= DEBOUNCE_PORTC_MASK;
+        PCMSK2 |= DEBOUNCE_PORTD_MASK;
+        PCIFR = (1 << PCIF2) | (1 << PCIF1)
+#if DEBOUNCE_PORTB_MASK
+            | (1 << PCIF0)
+#endif
+            ;
+        PCICR |= (DEBOUNCE_PORTB_MASK ? (1 << PCIE0) : 0)
+            | (DEBOUNCE_PORTC_MASK ? (1 << PCIE1) : 0)
+            | (DEBOUNCE_PORTD_MASK ? (1 << PCIE2) : 0);
+    }
+    timer_stop(TIMER_JOB_DEBOUNCE);
+#endif
+}
+
+#ifdef DEBOUNCE_PCINT_ON
+/**
+ * @brief moves the queued edges to their ports and starts sampling them.
+ */
+static void debounce_drain(void)
+{
+    uint8_t active = debounce_active;
+
+    while(debounce_queue.tail != debounce_queue.head){
+        volatile debounce_edge_t *e =
+            &debounce_queue.edge[debounce_queue.tail & (DEBOUNCE_QUEUE_SIZE - 1)];
+        debounce_port_t *p = &debounce[e->port];
+
+        if(!(active & (1 << e->port))) p->stamp = e->stamp;    // burst starts
+        p->pins = e->pins;
+        active |= 1 << e->port;
+        debounce_queue.tail++;
+    }
+
+    if(debounce_queue.overflows){               // lost edges: check every port
+        debounce_queue.overflows = 0;
+        active |= (1 << DEBOUNCE_PORTS) - 1;
+    }
+
+    if(active && !debounce_active)
+        timer_start(TIMER_JOB_DEBOUNCE, DEBOUNCE_SAMPLE_TICKS, DEBOUNCE_SAMPLE_TICKS);
+    debounce_active = active;
+}
+#endif
+
+/**
+ * @brief samples the ports. Polled, it must be called at a fixed rate (a pin
+ * toggles after DEBOUNCE_PORTx_SAMPLES stable calls). With DEBOUNCE_PCINT_ON
+ * it is called from the main loop and only samples when due.
+ */
+void debounce_task(void)
+{
+    uint8_t active = 0;
+
+#ifdef DEBOUNCE_PCINT_ON
+    debounce_drain();
+    if(!timer_take(TIMER_JOB_DEBOUNCE)) return;
+#endif
+
+#if DEBOUNCE_PORTB_MASK
+    if(debounce_port(&debounce[DEBOUNCE_PORTB], PINB, DEBOUNCE_PORTB_MASK, DEBOUNCE_PORTB_SAMPLES))
+        active |= 1 << DEBOUNCE_PORTB;
+#endif
+#if DEBOUNCE_PORTC_MASK
+    if(debounce_port(&debounce[DEBOUNCE_PORTC], PINC, DEBOUNCE_PORTC_MASK, DEBOUNCE_PORTC_SAMPLES))
+        active |= 1 << DEBOUNCE_PORTC;
+#endif
+#if DEBOUNCE_PORTD_MASK
+    if(debounce_port(&debounce[DEBOUNCE_PORTD], PIND, DEBOUNCE_PORTD_MASK, DEBOUNCE_PORTD_SAMPLES))
+        active |= 1 << DEBOUNCE_PORTD;
+#endif
+
+#ifdef DEBOUNCE_PCINT_ON
+    // settled: back to waiting for an edge
+    debounce_active = active;
+    if(!active) timer_stop(TIMER_JOB_DEBOUNCE);
+#else
+    (void)active;
+#endif
+}
+
+/**
+ * @brief returns the pins that toggled since the last call. The rising ones
+ * are `events & debounce[port].state`.
+ */
+uint8_t debounce_take_events(debounce_ports_t port)
+{
+    uint8_t events = debounce[port].events;
+    debounce[port].events = 0;
+    return events;
+}
+
+#ifdef DEBOUNCE_PCINT_ON
+/**
+ * @brief queues a port snapshot. Called only from the pin change isrs.
+ */
+void debounce_push(uint8_t port, uint8_t pins)
+{
+    if((uint8_t)(debounce_queue.head - debounce_queue.tail) >= DEBOUNCE_QUEUE_SIZE){
+        debounce_queue.overflows++;
+        return;
+    }
+
+    volatile debounce_edge_t *e =
+        &debounce_queue.edge[debounce_queue.head & (DEBOUNCE_QUEUE_SIZE - 1)];
+    e->port = port;
+    e->pins = pins;
+    e->stamp = timer_now();
+    debounce_queue.head++;
+}
+
+// with CAN_ON PCINT0 is CAN_INT_vect, handled in can_app.c
+#if DEBOUNCE_PORTB_MASK && !defined(CAN_ON)
+ISR(PCINT0_vect)
+{
+    debounce_push(DEBOUNCE_PORTB, PINB);
+}
+#endif
+
+#if DEBOUNCE_PORTC_MASK
+ISR(PCINT1_vect)
+{
+    debounce_push(DEBOUNCE_PORTC, PINC);
+}
+#endif
+
+#if DEBOUNCE_PORTD_MASK
+ISR(PCINT2_vect)
+{
+    debounce_push(DEBOUNCE_PORTD, PIND);
+}
+#endif
+#endif
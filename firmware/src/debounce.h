@@ -0,0 +1,100 @@
+/**
+ * @file debounce.h
+ *
+ * @defgroup DEBOUNCE Vertical Counter Debouncer Module
+ *
+ * @brief Debounces whole input ports at once.
+ *
+ * Each PINx is sampled once per call and every bit has its own 4-bit counter
+ * of consecutive samples that differ from the debounced state. The counters
+ * are kept bit-sliced (plane n holds bit n of the 8 counters), so the 8 pins
+ * of a port are counted in parallel with a few bitwise operations. When a
+ * counter reaches the port threshold the pin toggles and its bit is set in
+ * the event mask.
+ *
+ * Only the pins in DEBOUNCE_PORTx_MASK are debounced; a port with an empty
+ * mask costs nothing.
+ *
+ * With DEBOUNCE_PCINT_ON the ports are not polled. The pin change interrupts
+ * push a snapshot of the port and a timestamp into a small queue, and
+ * debounce_task(), called from the main loop, drains it and samples only
+ * the ports that moved, every DEBOUNCE_SAMPLE_MS until they settle. A change
+ * is then seen one debounce time after the first edge, and nothing runs
+ * while the inputs are idle. PCINT0 is shared with the MCP2515 INT pin when
+ * CAN_ON, and the can_app.c handler pushes the PORTB snapshot.
+ *
+ */
+
+#ifndef DEBOUNCE_H
+#define DEBOUNCE_H
+
+#include <avr/io.h>
+
+#include <avr/interrupt.h>
+#include <util/atomic.h>
+
+#include "conf.h"
+#include "../lib/bit_utils.h"
+#ifdef DEBOUNCE_PCINT_ON
+#include "timer.h"
+#endif
+
+#if DEBOUNCE_PORTB_SAMPLES < 1 || DEBOUNCE_PORTB_SAMPLES > 15 \
+    || DEBOUNCE_PORTC_SAMPLES < 1 || DEBOUNCE_PORTC_SAMPLES > 15 \
+    || DEBOUNCE_PORTD_SAMPLES < 1 || DEBOUNCE_PORTD_SAMPLES > 15
+#error "DEBOUNCE_PORTx_SAMPLES must be 1..15 (4-bit counters)"
+#endif
+
+typedef enum debounce_ports{
+    DEBOUNCE_PORTB,
+    DEBOUNCE_PORTC,
+    DEBOUNCE_PORTD,
+    DEBOUNCE_PORTS,
+} debounce_ports_t;
+
+#ifdef DEBOUNCE_PCINT_ON
+#define DEBOUNCE_QUEUE_SIZE     8           //<! must be a power of two
+#define DEBOUNCE_SAMPLE_TICKS   TIMER_MS_TO_TICKS(DEBOUNCE_SAMPLE_MS)
+
+typedef struct{
+    uint8_t port;
+    uint8_t pins;                           //<! PINx right after the edge
+    uint16_t stamp;                         //<! timer ticks
+} debounce_edge_t;
+
+typedef struct{
+    debounce_edge_t edge[DEBOUNCE_QUEUE_SIZE];
+    uint8_t head;                           //<! written by the isrs
+    uint8_t tail;                           //<! read by debounce_task()
+    uint8_t overflows;
+} debounce_queue_t;
+
+extern volatile debounce_queue_t debounce_queue;
+#endif
+
+typedef struct{
+    uint8_t state;                          //<! debounced pins
+    uint8_t count[4];                       //<! bit-sliced counters, plane 0 is the lsb
+    uint8_t events;                         //<! toggled pins not taken yet
+#ifdef DEBOUNCE_PCINT_ON
+    uint8_t pins;                           //<! last snapshot
+    uint16_t stamp;                         //<! first edge of the current burst
+    uint16_t event_stamp;                   //<! first edge of the last accepted change
+#endif
+} debounce_port_t;
+
+extern debounce_port_t debounce[DEBOUNCE_PORTS];
+#ifdef DEBOUNCE_PCINT_ON
+extern uint8_t debounce_active;             //<! bitmap of the ports being sampled
+#endif
+
+void debounce_init(void);
+void debounce_task(void);
+uint8_t debounce_take_events(debounce_ports_t port);
+#ifdef DEBOUNCE_PCINT_ON
+void debounce_push(uint8_t port, uint8_t pins);
+#endif
+
+#define debounce_pin(port, pin)     bit_is_set(debounce[port].state, pin)
+
+#endif /* ifndef DEBOUNCE_H */
@@ -0,0 +1,71 @@
+#include "latency.h"
+
+volatile latency_t latency;
+
+/**
+ * @brief clears the histogram.
+ */
+void latency_clear(void)
+{
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+        for(uint8_t i = 0; i < LATENCY_BUCKETS; i++) latency.bucket[i] = 0;
+        latency.min = UINT16_MAX;
+        latency.max = latency.count = 0;
+    }
+}
+
+/**
+ * @brief starts the measurements, see can_app_init() for the INT interrupt.
+ */
+void latency_init(void)
+{
+    latency_clear();
+    latency.rx_valid = latency.pending = 0;
+    latency.int_low = bit_is_clear(CAN_INT_PIN, CAN_INT);
+}
+
+/**
+ * @brief takes the stamp of the INT edge for the frame being read.
+ * @return 1 if there was an edge since the last take
+ */
+uint8_t latency_rx_take(uint16_t *stamp)
+{
+    uint8_t valid;
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+        valid = latency.rx_valid;
+        *stamp = latency.rx_stamp;
+        latency.rx_valid = 0;
+    }
+
+    return valid;
+}
+
+/**
+ * @brief marks the frame being parsed as the cause of the next output
+ * change. Called by the parser of the frames that drive the indicator.
+ */
+void latency_frame(uint8_t valid, uint16_t stamp)
+{
+    latency.pending = valid;
+    latency.frame_stamp = stamp;
+}
+
+/**
+ * @brief the derived output was written: closes the measurement, if any.
+ */
+void latency_output(void)
+{
+    if(!latency.pending) return;
+    latency.pending = 0;
+
+    uint16_t dt = timer_now() - latency.frame_stamp;
+    uint8_t n = 0;
+
+    for(uint16_t v = dt; v; v >>= 1) n++;       // log2(dt) + 1
+
+    if(latency.bucket[n] != UINT16_MAX) latency.bucket[n]++;
+    if(dt < latency.min) latency.min = dt;
+    if(dt > latency.max) latency.max = dt;
+    if(latency.count != UINT16_MAX) latency.count++;
+}
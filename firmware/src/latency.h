@@ -0,0 +1,69 @@
+/**
+ * @file latency.h
+ *
+ * @defgroup LATENCY CAN to LED Latency Module
+ *
+ * @brief Measures the time from a MAM19 state frame arriving at the MCP2515
+ * to the MOTOR_ON_OK indicator being changed.
+ *
+ * The falling edge of the MCP2515 INT pin is timestamped by the pin change
+ * interrupt of can_app.c. The stamp is taken by the frame read from the controller and
+ * follows it through the parser; when the derived led output is written the
+ * difference goes into a histogram with log2 buckets of timer ticks
+ * (bucket n holds 2^(n-1) to 2^n - 1 ticks, bucket 0 is under one tick).
+ *
+ * A frame read while INT was already low (another one was pending) has no
+ * edge of its own and is not measured.
+ *
+ */
+
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <util/atomic.h>
+
+#include "conf.h"
+#include "timer.h"
+#include "../lib/bit_utils.h"
+
+#define LATENCY_BUCKETS     17              //<! 0 and one per bit of the 16-bit ticks
+
+typedef struct latency{
+    uint16_t rx_stamp;                      //<! tick of the last INT edge
+    uint8_t rx_valid;                       //<! rx_stamp not taken yet
+    uint8_t int_low;                        //<! last seen level of the INT pin
+    uint8_t pending;                        //<! a measured frame changed the flags
+    uint16_t frame_stamp;                   //<! rx_stamp of that frame
+    uint16_t bucket[LATENCY_BUCKETS];
+    uint16_t min, max;                      //<! in ticks
+    uint16_t count;
+} latency_t;
+
+extern volatile latency_t latency;
+
+/**
+ * @brief stamps the falling edge of the MCP2515 INT (a frame was received).
+ * The first stamp is kept until it is taken. Called from CAN_INT_vect, which
+ * is shared with the PORTB debounced pins, so the INT level is tracked to
+ * tell its own edges.
+ */
+static inline void latency_int(void)
+{
+    uint8_t low = bit_is_clear(CAN_INT_PIN, CAN_INT) ? 1 : 0;
+
+    if(low && !latency.int_low && !latency.rx_valid){
+        latency.rx_stamp = timer_now();
+        latency.rx_valid = 1;
+    }
+    latency.int_low = low;
+}
+
+void latency_init(void);
+void latency_clear(void);
+uint8_t latency_rx_take(uint16_t *stamp);
+void latency_frame(uint8_t valid, uint16_t stamp);
+void latency_output(void);
+
+#endif /* ifndef LATENCY_H */
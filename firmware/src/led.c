@@ -0,0 +1,373 @@
+#include "led.h"
+#include "machine.h"
+
+volatile led_t led;
+uint16_t led_output_word;
+
+#define LED_OUTPUT_FLAGS_MASK   0x1F            //<! SYSTEM_FLAG_BOAT_SWITCH_ON..REVERSE_SWITCH
+// with SR595_ON these are the masks of chips 0 and 1
+#define LED_OUTPUT_PORTC_MASK   LOW(LED_OUTPUT_WORD(LED_OUTPUT_FLAGS_MASK))
+#define LED_OUTPUT_PORTD_MASK   HIGH(LED_OUTPUT_WORD(LED_OUTPUT_FLAGS_MASK))
+
+#ifdef SR595_ON
+#define LED_OUT_BOAT_ON_SWITCH      LED_OUT_SR(SR595_BOAT_ON_SWITCH)
+#define LED_OUT_MOTOR_ON_SWITCH     LED_OUT_SR(SR595_MOTOR_ON_SWITCH)
+#define LED_OUT_POT_ZERO            LED_OUT_SR(SR595_POT_ZERO)
+#define LED_OUT_DMS                 LED_OUT_SR(SR595_DMS)
+#define LED_OUT_REVERSE_SWITCH      LED_OUT_SR(SR595_REVERSE_SWITCH)
+#else
+#define LED_OUT_BOAT_ON_SWITCH      LED_OUT_D(BOAT_ON_SWITCH)
+#define LED_OUT_MOTOR_ON_SWITCH     LED_OUT_D(MOTOR_ON_SWITCH)
+#define LED_OUT_POT_ZERO            LED_OUT_C(POT_ZERO)
+#define LED_OUT_DMS                 LED_OUT_D(DMS)
+#define LED_OUT_REVERSE_SWITCH      LED_OUT_C(REVERSE_SWITCH)
+#endif
+
+#define LED_OUTPUT_WORD(f) (uint16_t)( \
+    ((f) & (1 << SYSTEM_FLAG_BOAT_SWITCH_ON)    ? LED_OUT_BOAT_ON_SWITCH        : 0) | \
+    ((f) & (1 << SYSTEM_FLAG_MOTOR_SWITCH_ON)   ? LED_OUT_MOTOR_ON_SWITCH       : 0) | \
+    ((f) & (1 << SYSTEM_FLAG_POT_ZERO)          ? LED_OUT_POT_ZERO              : 0) | \
+    ((f) & (1 << SYSTEM_FLAG_DMS_SWITCH)        ? LED_OUT_DMS                   : 0) | \
+    ((f) & (1 << SYSTEM_FLAG_REVERSE_SWITCH)    ? LED_OUT_REVERSE_SWITCH        : 0))
+
+#define LED_OUTPUT_WORD_4(f)    LED_OUTPUT_WORD(f), LED_OUTPUT_WORD((f) + 1), \
+                                LED_OUTPUT_WORD((f) + 2), LED_OUTPUT_WORD((f) + 3)
+#define LED_OUTPUT_WORD_16(f)   LED_OUTPUT_WORD_4(f), LED_OUTPUT_WORD_4((f) + 4), \
+                                LED_OUTPUT_WORD_4((f) + 8), LED_OUTPUT_WORD_4((f) + 12)
+
+/**
+ * @brief output word for each combination of the mirrored flags.
+ */
+static const uint16_t led_output_lut[LED_OUTPUT_FLAGS_MASK + 1] PROGMEM = {
+    LED_OUTPUT_WORD_16(0), LED_OUTPUT_WORD_16(16)
+};
+
+static const led_io_t led_io[LEDS] = {
+    [LED_BOAT_ON_OK]    = {&CTRL_SWITCHES_PORT, (1 << BOAT_ON_OK)},
+    [LED_MOTOR_ON_OK]   = {&MOTOR_ON_OK_PORT,   (1 << MOTOR_ON_OK)},
+};
+
+static volatile uint8_t * const led_ddr[LEDS] = {
+    [LED_BOAT_ON_OK]    = &CTRL_SWITCHES_DDR,
+    [LED_MOTOR_ON_OK]   = &MOTOR_ON_OK_DDR,
+};
+
+const uint8_t led_pattern_off[] PROGMEM = {
+    LED_LEVEL(0), LED_END
+};
+
+const uint8_t led_pattern_on[] PROGMEM = {
+    LED_LEVEL(LED_LEVEL_MAX), LED_END
+};
+
+const uint8_t led_pattern_charging[] PROGMEM = {
+    LED_LEVEL(LED_LEVEL_MAX), LED_WAIT(LED_MS_TO_STEPS(83)),
+    LED_LEVEL(0), LED_WAIT(LED_MS_TO_STEPS(83)),
+    LED_REPEAT(0)
+};
+
+const uint8_t led_pattern_motor_idle[] PROGMEM = {
+    LED_LEVEL(LED_LEVEL_MAX), LED_WAIT(LED_MS_TO_STEPS(250)),
+    LED_LEVEL(0), LED_WAIT(LED_MS_TO_STEPS(250)),
+    LED_REPEAT(0)
+};
+
+const uint8_t led_pattern_motor_contactor[] PROGMEM = {
+    LED_LEVEL(LED_LEVEL_MAX), LED_WAIT(LED_MS_TO_STEPS(333)),
+    LED_LEVEL(0), LED_WAIT(LED_MS_TO_STEPS(333)),
+    LED_REPEAT(0)
+};
+
+const uint8_t led_pattern_motor_running[] PROGMEM = {
+    LED_LEVEL(LED_LEVEL_MAX), LED_WAIT(LED_MS_TO_STEPS(417)),
+    LED_LEVEL(0), LED_WAIT(LED_MS_TO_STEPS(417)),
+    LED_REPEAT(0)
+};
+
+const uint8_t led_pattern_motor_error[] PROGMEM = {
+    LED_FADE(LED_LEVEL_MAX, LED_MS_TO_STEPS(500)),
+    LED_FADE(0, LED_MS_TO_STEPS(500)),
+    LED_REPEAT(0)
+};
+
+/**
+ * @brief updates the pwm duty from the level and the brightness scale.
+ */
+static inline void led_update_duty(volatile led_player_t *p)
+{
+    p->duty = ((uint16_t)(p->level >> 4) * p->brightness + 128) >> 8;
+}
+
+/**
+ * @brief advances one player by one step, running instructions until one
+ * of them takes time.
+ */
+static void led_step(volatile led_player_t *p)
+{
+    if(!p->pc) return;
+
+    if(p->wait){
+        if(p->fade) p->level += p->fade;
+        if(--p->wait){
+            led_update_duty(p);
+            return;
+        }
+        if(p->fade){
+            p->level = p->target;
+            p->fade = 0;
+        }
+    }
+
+    // bounded, so a pattern without waits can not hang the isr
+    for(uint8_t i = 0; i < 8; i++){
+        uint8_t op = pgm_read_byte(p->pc++);
+
+        if(op == LED_OP_END){
+            p->pc = 0;
+            break;
+        }
+
+        switch(op & LED_OP_MASK){
+            case LED_OP_LEVEL:
+                p->level = op << 4;
+                break;
+            case LED_OP_WAIT:
+                p->wait = pgm_read_byte(p->pc++);
+                break;
+            case LED_OP_FADE:
+                p->target = (op & 0x0F) << 4;
+                p->wait = pgm_read_byte(p->pc++);
+                if(p->wait < 2){
+                    p->level = p->target;
+                }else{
+                    p->fade = ((int16_t)p->target - p->level) / p->wait;
+                }
+                break;
+            case LED_OP_REPEAT:
+                if(!(op & 0x1F)){
+                    p->pc = p->pattern;             // forever
+                    break;
+                }
+                if(!p->repeat) p->repeat = (op & 0x1F) + 1;
+                if(--p->repeat) p->pc = p->pattern;
+                break;
+        }
+
+        if(p->wait) break;
+    }
+
+    led_update_duty(p);
+}
+
+/**
+ * @brief returns 1 if some led is at a duty strictly between 0 and max, so
+ * it needs the software pwm.
+ */
+uint8_t led_pwm_active(void)
+{
+    for(uint8_t i = 0; i < LEDS; i++)
+        if(led.player[i].duty && led.player[i].duty < LED_LEVEL_MAX) return 1;
+    return 0;
+}
+
+/**
+ * @brief chooses what advances the players. Must be called with interrupts
+ * off.
+ *
+ * The timer1 interrupt only runs while some led needs the software pwm.
+ * Otherwise the pins are written as fully on or off, and the patterns that
+ * are still running are stepped by a TIMER_JOB_LED deadline at their next
+ * instruction, see led_task().
+ */
+static void led_schedule(void)
+{
+    uint8_t steps = UINT8_MAX, running = 0;
+
+    if(led_pwm_active()){
+        timer_stop(TIMER_JOB_LED);
+        if(bit_is_clear(TIMSK1, OCIE1A)){
+            led.slot = 0;
+            TIFR1 = (1 << OCF1A);
+            set_bit(TIMSK1, OCIE1A);
+        }
+        return;
+    }
+
+    clr_bit(TIMSK1, OCIE1A);
+
+    for(uint8_t i = 0; i < LEDS; i++){
+        volatile led_player_t *p = &led.player[i];
+
+        if(p->duty) *led_io[i].port |= led_io[i].mask;
+        else *led_io[i].port &= ~led_io[i].mask;
+
+        if(p->pc){
+            running = 1;
+            if(p->wait && p->wait < steps) steps = p->wait;
+        }
+    }
+
+    if(!running){
+        timer_stop(TIMER_JOB_LED);
+        return;
+    }
+
+    if(steps == UINT8_MAX) steps = 1;               // bounded by led_step()
+    led.steps = steps;
+    timer_start(TIMER_JOB_LED, steps * LED_STEP_TICKS, 0);
+}
+
+/**
+ * @brief initializes the led pins and Timer1 as the engine time base.
+ *
+ * None of the indicators are on OC1A/OC1B (PB1 is the MCP2515 interrupt and
+ * PB2 the SPI SS, used by the WS2812 strip), so all of them use the software
+ * pwm.
+ */
+void led_init(void)
+{
+    for(uint8_t i = 0; i < LEDS; i++){
+        *led_ddr[i] |= led_io[i].mask;
+        led.player[i].pc = 0;
+        led.player[i].level = led.player[i].duty = 0;
+        led.player[i].brightness = LED_BRIGHTNESS_MAX;
+    }
+    led.slot = 0;
+
+    led_output_word = 0;
+#ifndef SR595_ON                                    // cleared by sr595_init()
+    PORTC &= ~LED_OUTPUT_PORTC_MASK;
+    PORTD &= ~LED_OUTPUT_PORTD_MASK;
+#endif
+
+    //clr_bit(PRR, PRTIM1);                          // Activates clock
+
+    // MODE 4 -> CTC with TOP on OCR1A
+    TCCR1A  =   (0 << WGM11) | (0 << WGM10)         // mode 4
+            | (0 << COM1B1) | (0 << COM1B0)         // do nothing
+            | (0 << COM1A1) | (0 << COM1A0);        // do nothing
+
+    TCCR1B  =
+#if LED_TIMER_PRESCALER ==     1
+                (0 << CS12) | (0 << CS11) | (1 << CS10) // Prescaler N=1
+#elif LED_TIMER_PRESCALER ==   8
+                (0 << CS12) | (1 << CS11) | (0 << CS10) // Prescaler N=8
+#elif LED_TIMER_PRESCALER ==   64
+                (0 << CS12) | (1 << CS11) | (1 << CS10) // Prescaler N=64
+#elif LED_TIMER_PRESCALER ==   256
+                (1 << CS12) | (0 << CS11) | (0 << CS10) // Prescaler N=256
+#elif LED_TIMER_PRESCALER ==   1024
+                (1 << CS12) | (0 << CS11) | (1 << CS10) // Prescaler N=1024
+#else
+                0
+#endif
+                | (0 << WGM13) | (1 << WGM12);      // mode 4
+
+    OCR1A = LED_TIMER_TOP;                          // OCR1A = TOP = fcpu/(N*f) -1
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+        led_schedule();
+    }
+}
+
+/**
+ * @brief steps the on/off patterns when their deadline is due. The players
+ * are advanced by the timer1 interrupt instead while the pwm runs.
+ */
+void led_task(void)
+{
+    if(!timer_take(TIMER_JOB_LED)) return;
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+        if(bit_is_set(TIMSK1, OCIE1A)) return;
+
+        for(uint8_t n = led.steps; n; n--)
+            for(uint8_t i = 0; i < LEDS; i++) led_step(&led.player[i]);
+
+        led_schedule();
+    }
+}
+
+/**
+ * @brief starts playing a pattern. Nothing happens if the same pattern is
+ * already playing, so it can be called on every tick.
+ * @param n is the led
+ * @param pattern is the pattern in flash
+ */
+void led_play(leds_t n, const uint8_t *pattern)
+{
+    volatile led_player_t *p = &led.player[n];
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+        if(p->pattern == pattern) return;
+
+        p->pattern = p->pc = pattern;
+        p->wait = p->repeat = 0;
+        p->fade = 0;
+        led_step(p);
+
+        led_schedule();
+    }
+}
+
+/**
+ * @brief sets the brightness scale of a led.
+ * @param brightness from 0 to LED_BRIGHTNESS_MAX
+ */
+void led_brightness(leds_t n, uint8_t brightness)
+{
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+        led.player[n].brightness = brightness;
+        led_update_duty(&led.player[n]);
+
+        led_schedule();
+    }
+}
+
+/**
+ * @brief writes the indicators that mirror a system flag. The ports are only
+ * touched when the derived word changes, with a single masked write each.
+ * @param flags is system_flags.all__
+ */
+void led_output(uint16_t flags)
+{
+    uint16_t word = pgm_read_word(&led_output_lut[flags & LED_OUTPUT_FLAGS_MASK]);
+    uint16_t diff = word ^ led_output_word;
+
+    if(!diff) return;
+
+#ifdef SR595_ON
+    sr595_write(0, LED_OUTPUT_PORTC_MASK, LOW(word));
+    sr595_write(1, LED_OUTPUT_PORTD_MASK, HIGH(word));
+    sr595_flush();
+#else
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+        if(LOW(diff))
+            PORTC = (PORTC & ~LED_OUTPUT_PORTC_MASK) | LOW(word);
+        if(HIGH(diff))
+            PORTD = (PORTD & ~LED_OUTPUT_PORTD_MASK) | HIGH(word);
+    }
+#endif
+
+    led_output_word = word;
+}
+
+/**
+ * @brief software pwm and pattern players.
+ */
+ISR(TIMER1_COMPA_vect)
+{
+    if(++led.slot >= LED_LEVEL_MAX){
+        led.slot = 0;
+        for(uint8_t i = 0; i < LEDS; i++) led_step(&led.player[i]);
+        if(!led_pwm_active()){
+            led_schedule();                         // back to the timer service
+            return;
+        }
+    }
+
+    for(uint8_t i = 0; i < LEDS; i++){
+        if(led.player[i].duty > led.slot) *led_io[i].port |= led_io[i].mask;
+        else *led_io[i].port &= ~led_io[i].mask;
+    }
+}
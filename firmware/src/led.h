@@ -0,0 +1,129 @@
+/**
+ * @file led.h
+ *
+ * @defgroup LED LED Engine Module
+ *
+ * @brief Brightness and pattern engine for the indicator LEDs.
+ *
+ * Each LED has a player that interprets a pattern stored in flash. While
+ * some LED is at a partial duty (a fade or a reduced brightness) the players
+ * are advanced from the Timer1 compare interrupt, which also does the
+ * software PWM for the pins. Otherwise every pin is fully on or off and the
+ * Timer1 interrupt is turned off: the patterns still running (e.g. blinks)
+ * are stepped by led_task() on a TIMER_JOB_LED deadline at their next
+ * instruction.
+ *
+ * The steady indicators that just mirror a flag are not played: they are
+ * packed into one output word and written with led_output(), to their pins
+ * or, with SR595_ON, to the 74HC595 chain in one spi burst.
+ *
+ * A pattern is a sequence of the following instructions:
+ *
+ *  - LED_LEVEL(l):     sets the level (0 to LED_LEVEL_MAX) immediately
+ *  - LED_WAIT(n):      holds for n steps
+ *  - LED_FADE(l, n):   goes linearly to level l in n steps
+ *  - LED_REPEAT(n):    plays again from the start n more times (0 forever)
+ *  - LED_END:          stops the player, keeping the last level
+ *
+ * @code
+ *  const uint8_t led_pattern_blink[] PROGMEM = {
+ *      LED_LEVEL(LED_LEVEL_MAX), LED_WAIT(10),
+ *      LED_LEVEL(0), LED_WAIT(10),
+ *      LED_REPEAT(0)
+ *  };
+ *  led_play(LED_MOTOR_ON_OK, led_pattern_blink);
+ * @endcode
+ *
+ */
+
+#ifndef LED_H
+#define LED_H
+
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+#include <avr/interrupt.h>
+#include <util/atomic.h>
+
+#include "conf.h"
+#include "timer.h"
+#include "../lib/bit_utils.h"
+#ifdef SR595_ON
+#include "sr595.h"
+#endif
+
+#define LED_LEVEL_MAX           15                                  //<! levels are 0..15
+#define LED_TIMER_FREQUENCY     ((uint32_t)LED_PWM_FREQUENCY * LED_LEVEL_MAX)
+#define LED_TIMER_TOP           ((F_CPU / LED_TIMER_PRESCALER) / LED_TIMER_FREQUENCY - 1)
+#define LED_MS_TO_STEPS(ms)     ((uint8_t)(((uint32_t)(ms) * LED_PWM_FREQUENCY) / 1000))
+#define LED_STEP_TICKS          TIMER_HZ_TO_TICKS(LED_PWM_FREQUENCY)
+
+#define LED_BRIGHTNESS_MAX      255
+
+// pattern instructions
+#define LED_OP_MASK             0xC0
+#define LED_OP_LEVEL            0x00
+#define LED_OP_WAIT             0x40
+#define LED_OP_FADE             0x80
+#define LED_OP_REPEAT           0xC0
+#define LED_OP_END              0xFF
+
+#define LED_LEVEL(l)            (LED_OP_LEVEL | ((l) & 0x0F))
+#define LED_WAIT(n)             LED_OP_WAIT, (n)
+#define LED_FADE(l, n)          (LED_OP_FADE | ((l) & 0x0F)), (n)
+#define LED_REPEAT(n)           (LED_OP_REPEAT | ((n) & 0x1F))
+#define LED_END                 LED_OP_END
+
+// packed output word: low byte is PORTC, high byte is PORTD, or with
+// SR595_ON the outputs 0 to 15 of the 74HC595 chain
+#define LED_OUT_C(pin)          ((uint16_t)1 << (pin))
+#define LED_OUT_D(pin)          ((uint16_t)1 << ((pin) + 8))
+#define LED_OUT_SR(n)           ((uint16_t)1 << (n))
+
+typedef enum leds{
+    LED_BOAT_ON_OK,
+    LED_MOTOR_ON_OK,
+    LEDS,
+} leds_t;
+
+typedef struct{
+    volatile uint8_t *port;
+    uint8_t mask;
+} led_io_t;
+
+typedef struct{
+    const uint8_t *pattern;                 //<! pattern being played (flash)
+    const uint8_t *pc;                      //<! next instruction, NULL if stopped
+    uint8_t level;                          //<! current level in Q4.4
+    uint8_t target;                         //<! fade target in Q4.4
+    int8_t fade;                            //<! fade increment per step in Q4.4
+    uint8_t wait;                           //<! steps left on the current instruction
+    uint8_t repeat;                         //<! repeats left
+    uint8_t brightness;                     //<! scale, LED_BRIGHTNESS_MAX is 100%
+    uint8_t duty;                           //<! pwm duty, 0 to LED_LEVEL_MAX
+} led_player_t;
+
+typedef struct led{
+    led_player_t player[LEDS];
+    uint8_t slot;                           //<! current pwm slot
+    uint8_t steps;                          //<! steps until the TIMER_JOB_LED deadline
+} led_t;
+
+extern volatile led_t led;
+extern uint16_t led_output_word;
+
+extern const uint8_t led_pattern_off[];
+extern const uint8_t led_pattern_on[];
+extern const uint8_t led_pattern_charging[];
+extern const uint8_t led_pattern_motor_idle[];
+extern const uint8_t led_pattern_motor_contactor[];
+extern const uint8_t led_pattern_motor_running[];
+extern const uint8_t led_pattern_motor_error[];
+
+void led_init(void);
+void led_play(leds_t n, const uint8_t *pattern);
+void led_brightness(leds_t n, uint8_t brightness);
+void led_output(uint16_t flags);
+void led_task(void);
+uint8_t led_pwm_active(void);
+
+#endif /* ifndef LED_H */
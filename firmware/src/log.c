@@ -0,0 +1,113 @@
+#include "log.h"
+
+volatile uint8_t log_mask = LOG_MASK_DEFAULT;
+
+/**
+ * @brief sends a tokenized record.
+ * @param id is the id of the log site
+ * @param args are the arguments, sent as little endian words
+ * @param n is the number of words in args
+ */
+void log_write(uint16_t id, const uint16_t *args, uint8_t n)
+{
+    usart_send_char(LOG_SYNC);
+    usart_send_char(LOW(id));
+    usart_send_char(HIGH(id));
+
+    while(n--){
+        usart_send_char(LOW(*args));
+        usart_send_char(HIGH(*args));
+        args++;
+    }
+}
+
+/**
+ * @brief sends a number in ascii, left filled up to width chars.
+ */
+static void log_send_number(uint32_t num, uint8_t base, uint8_t width, char fill)
+{
+    char str[11];
+    uint8_t i = 0;
+
+    do{
+        uint8_t d = num % base;
+        str[i++] = d < 10 ? '0' + d : 'a' + d - 10;
+        num /= base;
+    }while(num);
+
+    while(width-- > i) usart_send_char(fill);
+    while(i) usart_send_char(str[--i]);
+}
+
+/**
+ * @brief formats a log site as text, used when LOG_TOKENIZED_ON is off.
+ * Supports the `0` flag, width, the `h`, `hh` and `l` modifiers and the
+ * %u, %d, %i, %x, %c and %% conversions.
+ * @param fmt is the format string in flash
+ * @param args are the arguments, as in log_write()
+ * @param n is the number of words in args
+ */
+void log_write_text(const char *fmt, const uint16_t *args, uint8_t n)
+{
+    char c;
+
+    while((c = pgm_read_byte(fmt++)) != '\0'){
+        uint8_t width = 0, wide = 0;
+        char fill = ' ';
+        uint32_t value;
+
+        if(c != '%'){
+            usart_send_char(c);
+            continue;
+        }
+
+        c = pgm_read_byte(fmt++);
+        if(c == '%'){
+            usart_send_char(c);
+            continue;
+        }
+        if(c == '0'){
+            fill = '0';
+            c = pgm_read_byte(fmt++);
+        }
+        while(c >= '0' && c <= '9'){
+            width = width * 10 + c - '0';
+            c = pgm_read_byte(fmt++);
+        }
+        while(c == 'h' || c == 'l'){
+            if(c == 'l') wide = 1;
+            c = pgm_read_byte(fmt++);
+        }
+        if(c == '\0') return;
+
+        if(n < (wide ? 2 : 1)) return;              // missing arguments
+        value = *args++;
+        n--;
+        if(wide){
+            value |= (uint32_t)*args++ << 16;
+            n--;
+        }
+
+        switch(c){
+            case 'c':
+                usart_send_char(value);
+                break;
+            case 'x':
+            case 'X':
+                log_send_number(value, 16, width, fill);
+                break;
+            case 'd':
+            case 'i':
+                if(wide ? (int32_t)value < 0 : (int16_t)value < 0){
+                    usart_send_char('-');
+                    value = wide ? -(int32_t)value : (uint16_t)-(int16_t)value;
+                    if(width) width--;
+                }
+                log_send_number(value, 10, width, fill);
+                break;
+            default:
+                log_send_number(value, 10, width, fill);
+                break;
+        }
+    }
+}
@@ -0,0 +1,72 @@
+/**
+ * @file log.h
+ *
+ * @defgroup LOG Logging Module
+ *
+ * @brief Backend of the LOG_* macros from dbg_vrb.h.
+ *
+ * With LOG_TOKENIZED_ON each log site is sent as a record instead of text:
+ *
+ *  | LOG_SYNC | id (LSB) | id (MSB) | arg0 (LSB) | arg0 (MSB) | ... |
+ *
+ * The id is (LOG_MODULE << 11) | site, where site is unique inside the
+ * translation unit. The format string of each site is kept together with its
+ * id in the `.logstr` section, which is not loaded to the flash. The host
+ * tool (tools/log_decode.py) reads it back from the elf to decode the stream.
+ *
+ * The VERBOSE_MSG_* categories that are compiled in can also be muted at run
+ * time through log_mask (see the console `log` command).
+ *
+ * Every argument is sent as a 16-bit word. Conversions with the `l` length
+ * modifier take two words, the low one first.
+ *
+ */
+
+#ifndef LOG_H
+#define LOG_H
+
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+
+#include "conf.h"
+#include "usart.h"
+#include "../lib/bit_utils.h"
+
+#define LOG_SYNC                0x1E        //<! ascii record separator
+#define LOG_SITE_BITS           11
+#define LOG_SITE_MASK           ((1 << LOG_SITE_BITS) - 1)
+
+// modules, the upper 5 bits of the id
+#define LOG_MODULE_NONE         0
+#define LOG_MODULE_MAIN         1
+#define LOG_MODULE_MACHINE      2
+#define LOG_MODULE_ADC          3
+#define LOG_MODULE_CAN_APP      4
+#define LOG_MODULE_CONSOLE      5
+#define LOG_MODULE_WATCHDOG     6
+#define LOG_MODULE_RECOVERY     7
+#define LOG_MODULE_CAN_HEALTH   8
+
+// runtime mask of the VERBOSE_MSG_* categories
+#define LOG_MASK_ERROR          (1 << 0)
+#define LOG_MASK_CAN_APP        (1 << 1)
+#define LOG_MASK_ADC            (1 << 2)
+#define LOG_MASK_PWM            (1 << 3)
+#define LOG_MASK_INIT           (1 << 4)
+#define LOG_MASK_MACHINE        (1 << 5)
+#define LOG_MASK_ALL            0x3F
+
+#ifndef LOG_MASK_DEFAULT
+#define LOG_MASK_DEFAULT        LOG_MASK_ALL
+#endif
+
+#ifndef LOG_MODULE
+#define LOG_MODULE              LOG_MODULE_NONE
+#endif
+
+extern volatile uint8_t log_mask;
+
+void log_write(uint16_t id, const uint16_t *args, uint8_t n);
+void log_write_text(const char *fmt, const uint16_t *args, uint8_t n);
+
+#endif /* ifndef LOG_H */
@@ -1,58 +1,131 @@
+#define LOG_MODULE LOG_MODULE_MACHINE
 #include "machine.h"
 
-volatile state_machine_t state_machine;
+fsm_t machine_fsm;
+uint16_t machine_time_in_state[STATES];
 volatile pump_flags_t pump_flags;
 volatile system_flags_t system_flags;
 volatile error_flags_t error_flags;
 volatile uint16_t charge_count_error;
 volatile uint8_t relay_clk;
 volatile uint8_t first_boat_off;
-volatile uint8_t machine_clk;
-volatile uint8_t machine_clk_divider;
 volatile uint8_t total_errors; // Contagem de ERROS
 volatile uint16_t charge_count_error;
 volatile uint8_t reset_clk;
 
 volatile uint8_t led_clk_div;
 
+/**
+ * @brief entry actions, just announce the new state.
+ */
+static void state_error_entry(void)
+{
+#ifdef PERSIST_ON
+    persist_crumb(PERSIST_CRUMB_STATE(STATE_ERROR));
+#endif
+    VERBOSE_MSG_MACHINE(LOG_STR("\n>>>STATE ERROR\n"));
+}
+
+static void state_initializing_entry(void)
+{
+#ifdef PERSIST_ON
+    persist_crumb(PERSIST_CRUMB_STATE(STATE_INITIALIZING));
+#endif
+    VERBOSE_MSG_MACHINE(LOG_STR("\n>>>INITIALIZING STATE\n"));
+}
+
+static void state_idle_entry(void)
+{
+#ifdef PERSIST_ON
+    persist_crumb(PERSIST_CRUMB_STATE(STATE_IDLE));
+#endif
+    VERBOSE_MSG_MACHINE(LOG_STR("\n>>>IDLE STATE\n"));
+}
+
+static void state_running_entry(void)
+{
+#ifdef PERSIST_ON
+    persist_crumb(PERSIST_CRUMB_STATE(STATE_RUNNING));
+#endif
+    VERBOSE_MSG_MACHINE(LOG_STR("\n>>>RUNNING STATE\n"));
+}
+
+static void state_reset_entry(void)
+{
+#ifdef PERSIST_ON
+    persist_crumb(PERSIST_CRUMB_STATE(STATE_RESET));
+#endif
+    VERBOSE_MSG_MACHINE(LOG_STR("\n>>>RESET STATE\n"));
+}
+
+/**
+ * @brief guard: too many errors, give up and wait for the watchdog.
+ */
+static uint8_t machine_errors_exhausted(void)
+{
+    return total_errors >= MACHINE_ERRORS_TO_RESET;
+}
+
+static const fsm_transition_t machine_transitions[] PROGMEM = {
+    // from STATE_ERROR
+    {&machine_errors_exhausted, STATE_RESET},
+    {NULL,                      STATE_INITIALIZING},
+};
+
+static const fsm_state_t machine_states[STATES] PROGMEM = {
+    //                          entry                       run                 exit    first   count
+    [STATE_INITIALIZING]    = { &state_initializing_entry,  &task_initializing, NULL,   0,      0},
+    [STATE_IDLE]            = { &state_idle_entry,          &task_idle,         NULL,   0,      0},
+    [STATE_RUNNING]         = { &state_running_entry,       &task_running,      NULL,   0,      0},
+    [STATE_ERROR]           = { &state_error_entry,         &task_error,        NULL,   0,      2},
+    [STATE_RESET]           = { &state_reset_entry,         &task_reset,        NULL,   0,      0},
+};
+
 /**
  * @brief
  */
 void machine_init(void)
 {
-    // clr_bit(PRR0, PRTIM2);                          // Activates clock
-
-    // MODE 2 -> CTC with TOP on OCR1
-    TCCR2A = (1 << WGM21) | (0 << WGM20)      // mode 2
-             | (0 << COM2B1) | (0 << COM2B0)  // do nothing
-             | (0 << COM2A1) | (0 << COM2A0); // do nothing
-
-    TCCR2B =
-#if MACHINE_TIMER_PRESCALER == 1
-        (0 << CS22) | (0 << CS21) | (1 << CS20) // Prescaler N=1
-#elif MACHINE_TIMER_PRESCALER == 8
-        (0 << CS22) | (1 << CS21) | (0 << CS20) // Prescaler N=8
-#elif MACHINE_TIMER_PRESCALER == 32
-        (0 << CS22) | (1 << CS21) | (1 << CS20) // Prescaler N=32
-#elif MACHINE_TIMER_PRESCALER == 64
-        (1 << CS22) | (0 << CS21) | (0 << CS20) // Prescaler N=64
-#elif MACHINE_TIMER_PRESCALER == 128
-        (1 << CS22) | (0 << CS21) | (1 << CS20) // Prescaler N=128
-#elif MACHINE_TIMER_PRESCALER == 256
-        (1 << CS22) | (1 << CS21) | (0 << CS20) // Prescaler N=256
-#elif MACHINE_TIMER_PRESCALER == 1024
-        (1 << CS22) | (1 << CS21) | (1 << CS20) // Prescaler N=1024
-#else
-        0
+    timer_start(TIMER_JOB_MACHINE, TIMER_HZ_TO_TICKS(MACHINE_FREQUENCY),
+                TIMER_HZ_TO_TICKS(MACHINE_FREQUENCY));
+#if defined(CAN_ON) && defined(CAN_HEALTH_ON)
+    can_health_init();
+#endif
+
+    reset_switches();
+    set_machine_initial_state();
+#ifdef RECOVERY_ON
+    recovery_init();
 #endif
-        | (0 << WGM22); // mode 2
 
-    OCR2A = MACHINE_TIMER_TOP; // OCR2A = TOP = fcpu/(N*2*f) -1
+#ifdef PERSIST_ON
+    // warm restart: resumes the saved state without initializing again. An
+    // exhausted error count was the reason of the reset, so it starts over.
+    if (persist_warm && persist.total_errors < MACHINE_ERRORS_TO_RESET)
+    {
+        total_errors = persist.total_errors;
 
-    TIMSK2 |= (1 << OCIE2A); // Activates interruption
+        if (persist.state == STATE_RUNNING)
+        {
+            system_flags.all__ = persist.system_flags;
+            system_flags.changed = 0xFFFF;
 
-    set_machine_initial_state();
-    set_state_initializing();
+            fsm_init(&machine_fsm, machine_states, machine_transitions,
+                    machine_time_in_state, STATES, STATE_RUNNING);
+            return;
+        }
+
+        if (persist.state == STATE_ERROR)
+        {
+            fsm_init(&machine_fsm, machine_states, machine_transitions,
+                    machine_time_in_state, STATES, STATE_ERROR);
+            return;
+        }
+    }
+#endif
+
+    fsm_init(&machine_fsm, machine_states, machine_transitions,
+            machine_time_in_state, STATES, STATE_INITIALIZING);
 }
 
 /**
@@ -61,7 +134,7 @@ void machine_init(void)
 inline void set_machine_initial_state(void)
 {
     error_flags.all = 0;
-    machine_clk = machine_clk_divider = led_clk_div = 0;
+    led_clk_div = 0;
 }
 
 /**
@@ -69,8 +142,7 @@ inline void set_machine_initial_state(void)
  */
 inline void set_state_error(void)
 {
-    VERBOSE_MSG_MACHINE(usart_send_string("\n>>>STATE ERROR\n"));
-    state_machine = STATE_ERROR;
+    fsm_request(&machine_fsm, STATE_ERROR);
 }
 
 /**
@@ -78,8 +150,7 @@ inline void set_state_error(void)
  */
 inline void set_state_initializing(void)
 {
-    VERBOSE_MSG_MACHINE(usart_send_string("\n>>>INITIALIZING STATE\n"));
-    state_machine = STATE_INITIALIZING;
+    fsm_request(&machine_fsm, STATE_INITIALIZING);
 }
 
 /**
@@ -87,8 +158,7 @@ inline void set_state_initializing(void)
  */
 inline void set_state_idle(void)
 {
-    VERBOSE_MSG_MACHINE(usart_send_string("\n>>>IDLE STATE\n"));
-    state_machine = STATE_IDLE;
+    fsm_request(&machine_fsm, STATE_IDLE);
 }
 
 /**
@@ -96,8 +166,7 @@ inline void set_state_idle(void)
  */
 inline void set_state_running(void)
 {
-    VERBOSE_MSG_MACHINE(usart_send_string("\n>>>RUNNING STATE\n"));
-    state_machine = STATE_RUNNING;
+    fsm_request(&machine_fsm, STATE_RUNNING);
 }
 
 /**
@@ -105,8 +174,37 @@ inline void set_state_running(void)
  */
 inline void set_state_reset(void)
 {
-    VERBOSE_MSG_MACHINE(usart_send_string("\n>>>RESET STATE\n"));
-    state_machine = STATE_RESET;
+    fsm_request(&machine_fsm, STATE_RESET);
+}
+
+/**
+ * @brief updates the masked system flags in a single assignment, so readers
+ * (and other writers) never see a partial update.
+ * @param mask selects the flags to be written
+ * @param value has the new state of the masked flags
+ */
+void system_flags_write(uint16_t mask, uint16_t value)
+{
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+        uint16_t old = system_flags.all__;
+        uint16_t now = (old & ~mask) | (value & mask);
+
+        system_flags.all__ = now;
+        system_flags.changed |= old ^ now;
+    }
+}
+
+/**
+ * @brief returns and clears the flags toggled since the last call.
+ */
+uint16_t system_flags_take_changes(void)
+{
+    uint16_t changed;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+        changed = system_flags.changed;
+        system_flags.changed = 0;
+    }
+    return changed;
 }
 
 /**
@@ -123,8 +221,9 @@ inline void task_initializing(void)
 #endif
 
     set_machine_initial_state();
+    system_flags.changed = 0xFFFF;              // refresh every output
 
-    VERBOSE_MSG_INIT(usart_send_string("System initialized without errors.\n"));
+    VERBOSE_MSG_INIT(LOG_STR("System initialized without errors.\n"));
     set_state_idle();
 }
 
@@ -133,6 +232,10 @@ inline void task_initializing(void)
  */
 inline void task_idle(void)
 {
+#ifdef CAN_ON
+    can_app_task();
+#endif /* CAN_ON */
+
     set_state_running();
 }
 
@@ -143,44 +246,105 @@ inline void task_idle(void)
  */
 inline void task_running(void)
 {
-    static uint16_t clk = 0;
+    static uint16_t infos_changed = 0;
+    uint16_t changed;
 
-    if (!(clk % 2))
-        print_infos();
+#ifdef CAN_ON
+    can_app_task();
+#endif /* CAN_ON */
 
-    SET_LED(CTRL_SWITCHES_PORT, BOAT_ON_SWITCH, system_flags.boat_switch_on);
-    SET_LED(CTRL_SWITCHES_PORT, MOTOR_ON_SWITCH, system_flags.motor_switch_on);
-    SET_LED(DMS_PORT, DMS, system_flags.dms_switch);
-    SET_LED(REVERSE_SWITCH_PORT, REVERSE_SWITCH, system_flags.reverse_switch);
-    SET_LED(POT_ZERO_PORT, POT_ZERO, system_flags.pot_zero);
+    changed = system_flags_take_changes();
 
-    if (system_flags.boat_charging){
-        if (!(clk % 10))
-            cpl_bit(CTRL_SWITCHES_PORT, BOAT_ON_OK);
+    // one-shot, armed by the first change after the last print
+    infos_changed |= changed;
+    if (infos_changed){
+        if (timer_take(TIMER_JOB_INFOS)){
+            infos_changed = 0;
+            print_infos();
+        }else if (!timer_armed(TIMER_JOB_INFOS)){
+            timer_start(TIMER_JOB_INFOS, TIMER_HZ_TO_TICKS(MACHINE_INFOS_FREQUENCY), 0);
+        }
     }
 
-    if (system_flags.motor_idle){
-        if (!(clk % 30))
-            cpl_bit(MOTOR_ON_OK_PORT, MOTOR_ON_OK);
-    }else if (system_flags.motor_waiting_contactor){
-        if (!(clk % 40))
-            cpl_bit(MOTOR_ON_OK_PORT, MOTOR_ON_OK);
-    }else if (system_flags.motor_running){
-        if (!(clk % 50))
-            cpl_bit(MOTOR_ON_OK_PORT, MOTOR_ON_OK);
-    }
+    if (!changed)
+        return;
+
+#ifdef PERSIST_ON
+    persist_save(machine_fsm.state, total_errors, system_flags.all__);
+#endif
 
-    if (system_flags.boat_on)
-        set_bit(CTRL_SWITCHES_PORT, BOAT_ON_OK);
+#ifdef ANIM_ON
+    if (changed & (SYSTEM_FLAGS_MCS_MASK | SYSTEM_FLAGS_MAM_MASK))
+        anim_select(system_flags.all__);
+#endif
 
+#ifdef LED_ON
+    led_output(system_flags.all__);
+
+    if (changed & SYSTEM_FLAGS_MCS_MASK){
+        if (system_flag(SYSTEM_FLAG_BOAT_ON))
+            led_play(LED_BOAT_ON_OK, led_pattern_on);
+        else if (system_flag(SYSTEM_FLAG_BOAT_CHARGING))
+            led_play(LED_BOAT_ON_OK, led_pattern_charging);
+        else
+            led_play(LED_BOAT_ON_OK, led_pattern_off);
+    }
 
+    if (changed & SYSTEM_FLAGS_MAM_MASK){
+        if (system_flag(SYSTEM_FLAG_MOTOR_IDLE))
+            led_play(LED_MOTOR_ON_OK, led_pattern_motor_idle);
+        else if (system_flag(SYSTEM_FLAG_MOTOR_WAITING_CONTACTOR))
+            led_play(LED_MOTOR_ON_OK, led_pattern_motor_contactor);
+        else if (system_flag(SYSTEM_FLAG_MOTOR_RUNNING))
+            led_play(LED_MOTOR_ON_OK, led_pattern_motor_running);
+        else if (system_flag(SYSTEM_FLAG_MOTOR_ERROR))
+            led_play(LED_MOTOR_ON_OK, led_pattern_motor_error);
+        else
+            led_play(LED_MOTOR_ON_OK, led_pattern_off);
+
+#ifdef LATENCY_ON
+        latency_output();
+#endif
+    }
+#endif
+}
+
+/**
+ * @brief samples the local inputs, see debounce.h
+ */
+inline void read_switches(void)
+{
+#if defined(DEBOUNCE_ON) && !defined(DEBOUNCE_PCINT_ON)
+    debounce_task();                            // else from the main loop
+#endif
+}
 
+/**
+ * @brief updates the flags derived from the adc comparators, see adc.h
+ */
+inline void read_potentiometers(void)
+{
+#if defined(ADC_ON) && defined(ADC_CMP_ON)
+    if (adc_take_events() & (1 << ADC_CMP_POT_CHANNEL))
+        system_flags_write(1 << SYSTEM_FLAG_POT_ZERO,
+            (adc.low & (1 << ADC_CMP_POT_CHANNEL)) ? (1 << SYSTEM_FLAG_POT_ZERO) : 0);
+#endif
+}
 
-    clk++;
+/**
+ * @brief drops the debouncing history, taking the pins as they are now.
+ */
+void reset_switches(void)
+{
+#ifdef DEBOUNCE_ON
+    debounce_init();
+#endif
 }
 
 /**
- * @brief error task checks the system and tries to medicine it.
+ * @brief error task checks the system and tries to medicine it. On the next
+ * tick the machine goes back to initializing, or to reset if too many errors
+ * were accumulated.
  */
 inline void task_error(void)
 {
@@ -192,28 +356,25 @@ inline void task_error(void)
     }
 #endif
 
-    set_state_initializing();
-
     total_errors++; // incrementa a contagem de erros
-    VERBOSE_MSG_ERROR(usart_send_string("The error code is: "));
-    VERBOSE_MSG_ERROR(usart_send_uint16(error_flags.all));
-    VERBOSE_MSG_ERROR(usart_send_char('\n'));
+#ifdef PERSIST_ON
+    persist_crumb(PERSIST_CRUMB_ERROR);
+    persist_save(machine_fsm.state, total_errors, system_flags.all__);
+#endif
+    VERBOSE_MSG_ERROR(LOG_FMT("The error code is: %05u\n", error_flags.all));
 
     if (!error_flags.all)
-        VERBOSE_MSG_ERROR(usart_send_string("\t - Oh no, it was some unknown error.\n"));
+        VERBOSE_MSG_ERROR(LOG_STR("\t - Oh no, it was some unknown error.\n"));
 
-    VERBOSE_MSG_ERROR(usart_send_string("The error level is: "));
-    VERBOSE_MSG_ERROR(usart_send_uint16(total_errors));
-    VERBOSE_MSG_ERROR(usart_send_char('\n'));
+    VERBOSE_MSG_ERROR(LOG_FMT("The error level is: %05u\n", total_errors));
 
     if (total_errors < 2)
     {
-        VERBOSE_MSG_ERROR(usart_send_string("I will reset the machine state.\n"));
+        VERBOSE_MSG_ERROR(LOG_STR("I will reset the machine state.\n"));
     }
-    if (total_errors >= 20)
+    if (total_errors >= MACHINE_ERRORS_TO_RESET)
     {
-        VERBOSE_MSG_ERROR(usart_send_string("The watchdog will reset the whole system.\n"));
-        set_state_reset();
+        VERBOSE_MSG_ERROR(LOG_STR("The watchdog will reset the whole system.\n"));
     }
 
 #ifdef LED_ON
@@ -222,7 +383,8 @@ inline void task_error(void)
 }
 
 /**
- * @brief reset error task just freezes the processor and waits for watchdog
+ * @brief reset error task freezes the processor and resets it through the
+ * watchdog, with its shortest time-out.
  */
 inline void task_reset(void)
 {
@@ -232,7 +394,16 @@ inline void task_reset(void)
 
     cli(); // disable interrupts
 
-    VERBOSE_MSG_ERROR(usart_send_string("WAITING FOR A RESET!\n"));
+#ifdef PERSIST_ON
+    persist_crumb(PERSIST_CRUMB_RESET);
+#endif
+
+    VERBOSE_MSG_ERROR(LOG_STR("WAITING FOR A RESET!\n"));
+
+#ifdef WATCHDOG_ON
+    wdt_fast_reset();
+#endif
+
     for (;;)
     {
     };
@@ -241,38 +412,47 @@ inline void task_reset(void)
 void print_infos(void)
 {
 
-    VERBOSE_MSG_MACHINE(usart_send_string("\nMIC: "));
-    VERBOSE_MSG_MACHINE(usart_send_string(" bo_sw: "));
-    VERBOSE_MSG_MACHINE(usart_send_char(system_flags.boat_switch_on + '0'));
-    VERBOSE_MSG_MACHINE(usart_send_string(" mo_sw: "));
-    VERBOSE_MSG_MACHINE(usart_send_char(system_flags.motor_switch_on + '0'));
-    VERBOSE_MSG_MACHINE(usart_send_string(" pot_0: "));
-    VERBOSE_MSG_MACHINE(usart_send_char(system_flags.pot_zero + '0'));
-    VERBOSE_MSG_MACHINE(usart_send_string(" dms_sw: "));
-    VERBOSE_MSG_MACHINE(usart_send_char(system_flags.dms_switch + '0'));
-    VERBOSE_MSG_MACHINE(usart_send_string(" re_sw: "));
-    VERBOSE_MSG_MACHINE(usart_send_char(system_flags.reverse_switch + '0'));
-    VERBOSE_MSG_MACHINE(usart_send_string(" | MCS: "));
-    VERBOSE_MSG_MACHINE(usart_send_string(" bo_on: "));
-    VERBOSE_MSG_MACHINE(usart_send_char(system_flags.boat_on + '0'));
-    VERBOSE_MSG_MACHINE(usart_send_string(" bo_ch: "));
-    VERBOSE_MSG_MACHINE(usart_send_char(system_flags.boat_charging + '0'));
-    VERBOSE_MSG_MACHINE(usart_send_string(" | MAM: "));
-    VERBOSE_MSG_MACHINE(usart_send_string(" mo_running: "));
-    VERBOSE_MSG_MACHINE(usart_send_char(system_flags.motor_running + '0'));
-    VERBOSE_MSG_MACHINE(usart_send_string(" mo_idle: "));
-    VERBOSE_MSG_MACHINE(usart_send_char(system_flags.motor_idle + '0'));
-    VERBOSE_MSG_MACHINE(usart_send_string(" mo_wa_co: "));
-    VERBOSE_MSG_MACHINE(usart_send_char(system_flags.motor_waiting_contactor + '0'));
-    VERBOSE_MSG_MACHINE(usart_send_string(" mo_error: "));
-    VERBOSE_MSG_MACHINE(usart_send_char(system_flags.motor_error + '0'));
-    VERBOSE_MSG_MACHINE(usart_send_string(" | MCB: "));
-    VERBOSE_MSG_MACHINE(usart_send_string(" mcbs_ok: "));
-    VERBOSE_MSG_MACHINE(usart_send_char(system_flags.mcbs_ok + '0'));
+    VERBOSE_MSG_MACHINE(LOG_FMT(
+        "\nMIC:  bo_sw: %u mo_sw: %u pot_0: %u dms_sw: %u re_sw: %u"
+        " | MCS:  bo_on: %u bo_ch: %u"
+        " | MAM:  mo_running: %u mo_idle: %u mo_wa_co: %u mo_error: %u"
+        " | MCB:  mcbs_ok: %u",
+        system_flag(SYSTEM_FLAG_BOAT_SWITCH_ON),
+        system_flag(SYSTEM_FLAG_MOTOR_SWITCH_ON),
+        system_flag(SYSTEM_FLAG_POT_ZERO),
+        system_flag(SYSTEM_FLAG_DMS_SWITCH),
+        system_flag(SYSTEM_FLAG_REVERSE_SWITCH),
+        system_flag(SYSTEM_FLAG_BOAT_ON),
+        system_flag(SYSTEM_FLAG_BOAT_CHARGING),
+        system_flag(SYSTEM_FLAG_MOTOR_RUNNING),
+        system_flag(SYSTEM_FLAG_MOTOR_IDLE),
+        system_flag(SYSTEM_FLAG_MOTOR_WAITING_CONTACTOR),
+        system_flag(SYSTEM_FLAG_MOTOR_ERROR),
+        system_flag(SYSTEM_FLAG_MCBS_OK)));
 }
 
 /**
- * @brief this is the machine state itself.
+ * @brief returns 1 if something woke the machine between its ticks: a can
+ * frame waiting in the MCP2515 or a deadline of the running task.
+ */
+static inline uint8_t machine_event_pending(void)
+{
+    uint8_t pending = timer_due(TIMER_JOB_INFOS);
+
+#ifdef CAN_ON
+    pending |= can_app_rx_pending() || timer_due(TIMER_JOB_CAN_TIMEOUT);
+#ifdef CAN_HEALTH_ON
+    pending |= timer_due(TIMER_JOB_CAN_HEALTH);
+#endif
+#endif
+
+    return pending;
+}
+
+/**
+ * @brief this is the machine state itself. The fsm runs on the supervision
+ * tick; between the ticks only the running task is run, when an event is
+ * pending, so the time in state still counts ticks.
  */
 inline void machine_run(void)
 {
@@ -280,67 +460,31 @@ inline void machine_run(void)
 
     // print_system_flags();
 
-    if (machine_clk)
+    if (!timer_take(TIMER_JOB_MACHINE))
     {
-        machine_clk = 0;
-#ifdef ADC_ON
-        if (adc.ready)
-        {
-            adc.ready = 0;
-
-            if (error_flags.all)
-            {
-                print_system_flags();
-                print_infos();
-                set_state_error();
-            }
-
-            switch (state_machine)
-            {
-            case STATE_INITIALIZING:
-                task_initializing();
-
-                break;
-            case STATE_IDLE:
-                task_idle();
-#ifdef CAN_ON
-                can_app_task();
-#endif /* CAN_ON */
-                break;
-            case STATE_RUNNING:
-                task_running();
-#ifdef CAN_ON
-                can_app_task();
-#endif /* CAN_ON */
+        if (machine_fsm.state == STATE_RUNNING && machine_event_pending())
+            task_running();
+        return;
+    }
 
-                break;
-            case STATE_ERROR:
-                task_error();
+#ifdef WATCHDOG_ON
+    wdt_checkin(WDT_TASK_MACHINE);
+#endif
+    read_switches();
+    read_potentiometers();
 
-            case STATE_RESET:
-            default:
-                task_reset();
-                break;
-            }
-        }
-#endif /* ADC_ON */
-    }
-}
+#ifdef RECOVERY_ON
+    if (machine_fsm.state != STATE_RESET)
+        recovery_task();
+#endif
 
-/**
- * @brief ISR para ações de controle
- */
-ISR(TIMER2_COMPA_vect)
-{
-    if (machine_clk_divider++ == MACHINE_CLK_DIVIDER_VALUE)
+    if (error_flags.all && machine_fsm.state != STATE_ERROR
+            && machine_fsm.state != STATE_RESET)
     {
-        /*if(machine_clk){
-            for(;;){
-                pwm_reset();
-                VERBOSE_MSG_ERROR(if(machine_clk) usart_send_string("\nERROR: CLOCK CONFLICT!!!\n"));
-            }
-        }*/
-        machine_clk = 1;
-        machine_clk_divider = 0;
+        print_system_flags();
+        print_infos();
+        set_state_error();
     }
+
+    fsm_run(&machine_fsm);
 }
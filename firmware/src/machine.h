@@ -14,26 +14,60 @@
 #include <avr/wdt.h>
 #include <avr/interrupt.h>
 #include <util/delay.h>
+#include <util/atomic.h>
 
 #include "conf.h"
-
-// Equations for mode 2 (CTC with TOP OCR2A)
-// Note the resolution. For example.. at 150hz, ICR1 = PWM_TOP = 159, so it
-#define MACHINE_TIMER_TOP ((F_CPU / (2 * MACHINE_TIMER_PRESCALER)) / (MACHINE_TIMER_FREQUENCY)-1)
+#include "timer.h"
+#include "../lib/fsm.h"
+#ifdef PERSIST_ON
+#include "persist.h"
+#endif
+#ifdef RECOVERY_ON
+#include "recovery.h"
+#endif
+#ifdef DEBOUNCE_ON
+#include "debounce.h"
+#endif
+#ifdef LED_ON
+#include "led.h"
+#endif
+#ifdef SR595_ON
+#include "sr595.h"
+#endif
+#ifdef WS2812_ON
+#include "ws2812.h"
+#ifdef ANIM_ON
+#include "anim.h"
+#endif
+#endif
 
 #ifdef ADC_ON
 #include "adc.h"
+#ifdef ADC_NR_ON
+#include "sleep.h"
+#endif
 #endif
 #ifdef USART_ON
 #include "usart.h"
 #endif
 #include "dbg_vrb.h"
+#ifdef WATCHDOG_ON
+#include "watchdog.h"
+#endif
 #ifdef CAN_ON
 #include "can.h"
 #include "can_app.h"
+#ifdef CAN_HEALTH_ON
+#include "can_health.h"
+#endif
+#ifdef LATENCY_ON
+#include "latency.h"
+#endif
 extern const uint8_t can_filter[];
 #endif
 
+#define MACHINE_ERRORS_TO_RESET     20      //<! errors before waiting for the watchdog
+
 typedef enum state_machine
 {
     STATE_INITIALIZING,
@@ -41,33 +75,50 @@ typedef enum state_machine
     STATE_RUNNING,
     STATE_ERROR,
     STATE_RESET,
+    STATES,
 } state_machine_t;
 
-typedef union system_flags
+/**
+ * @brief system flags packed in a single word. Writers go through
+ * system_flags_write(), which applies a whole mask at once with interrupts
+ * off and accumulates the toggled bits in `changed`.
+ */
+typedef struct system_flags
 {
-    struct
-    {
-        // MIC
-        uint16_t boat_switch_on : 1;
-        uint16_t motor_switch_on : 1;
-        uint16_t pot_zero : 1;
-        uint16_t dms_switch : 1;
-        uint16_t reverse_switch : 1;
-        // MCS
-        uint16_t boat_on : 1;
-        uint16_t boat_charging : 1;
-        // MAM
-        uint16_t motor_running : 1;
-        uint16_t motor_idle : 1;
-        uint16_t motor_waiting_contactor : 1;
-        uint16_t motor_error : 1;
-        // MCB
-        uint16_t mcbs_ok : 1;
-        
-    };
     uint16_t all__;
+    uint16_t changed;                       //<! bits toggled since last taken
 } system_flags_t;
 
+// bit positions of system_flags.all__
+// MIC
+#define SYSTEM_FLAG_BOAT_SWITCH_ON          0
+#define SYSTEM_FLAG_MOTOR_SWITCH_ON         1
+#define SYSTEM_FLAG_POT_ZERO                2
+#define SYSTEM_FLAG_DMS_SWITCH              3
+#define SYSTEM_FLAG_REVERSE_SWITCH          4
+// MCS
+#define SYSTEM_FLAG_BOAT_ON                 5
+#define SYSTEM_FLAG_BOAT_CHARGING           6
+// MAM
+#define SYSTEM_FLAG_MOTOR_RUNNING           7
+#define SYSTEM_FLAG_MOTOR_IDLE              8
+#define SYSTEM_FLAG_MOTOR_WAITING_CONTACTOR 9
+#define SYSTEM_FLAG_MOTOR_ERROR             10
+// MCB
+#define SYSTEM_FLAG_MCBS_OK                 11
+
+#define SYSTEM_FLAGS_MIC_MOTOR_MASK ((1 << SYSTEM_FLAG_MOTOR_SWITCH_ON)   \
+                                    | (1 << SYSTEM_FLAG_DMS_SWITCH)       \
+                                    | (1 << SYSTEM_FLAG_REVERSE_SWITCH))
+#define SYSTEM_FLAGS_MCS_MASK       ((1 << SYSTEM_FLAG_BOAT_ON)           \
+                                    | (1 << SYSTEM_FLAG_BOAT_CHARGING))
+#define SYSTEM_FLAGS_MAM_MASK       ((1 << SYSTEM_FLAG_MOTOR_RUNNING)     \
+                                    | (1 << SYSTEM_FLAG_MOTOR_IDLE)       \
+                                    | (1 << SYSTEM_FLAG_MOTOR_WAITING_CONTACTOR) \
+                                    | (1 << SYSTEM_FLAG_MOTOR_ERROR))
+
+#define system_flag(f)              ((system_flags.all__ >> (f)) & 1)
+
 typedef union pump_flags
 {
     struct
@@ -83,6 +134,8 @@ typedef union error_flags
     struct
     {
         uint8_t no_canbus : 1;
+        uint8_t adc_stall : 1;
+        uint8_t usart : 1;
     };
     uint8_t all;
 } error_flags_t;
@@ -94,6 +147,7 @@ void reset_measurements(void);
 void average_measurements(void);
 
 // debug functions
+void print_infos(void);
 void print_configurations(void);
 void print_system_flags(void);
 void print_error_flags(void);
@@ -117,6 +171,10 @@ void set_state_running(void);
 void set_state_reset(void);
 void set_state_waiting_reset(void);
 
+// system flags
+void system_flags_write(uint16_t mask, uint16_t value);
+uint16_t system_flags_take_changes(void);
+
 // input functions
 void read_switches(void);
 void read_potentiometers(void);
@@ -129,15 +187,14 @@ void average_potentiometers(void);
 void buzzer(uint8_t buzzer_frequency, uint8_t buzzer_rhythm_on, uint8_t buzzer_rhythm_off);
 
 // machine variables
-extern volatile state_machine_t state_machine;
+extern fsm_t machine_fsm;                    //<! machine_fsm.state is a state_machine_t
+extern uint16_t machine_time_in_state[STATES];
 extern volatile pump_flags_t pump_flags;
 extern volatile system_flags_t system_flags;
 extern volatile error_flags_t error_flags;
 extern volatile uint16_t charge_count_error;
 extern volatile uint8_t relay_clk;
 extern volatile uint8_t first_boat_off;
-extern volatile uint8_t machine_clk;
-extern volatile uint8_t machine_clk_divider;
 extern volatile uint8_t total_errors; // Contagem de ERROS
 extern volatile uint16_t charge_count_error;
 extern volatile uint8_t reset_clk;
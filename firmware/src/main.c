@@ -1,25 +1,73 @@
 // coding: utf-8
 
+#define LOG_MODULE LOG_MODULE_MAIN
 #include "main.h"
 
+uint16_t boot_profile[BOOT_STAGES];
+
 void init(void)
 {
+    #ifdef PERSIST_ON
+        #ifdef WATCHDOG_ON
+        persist_restore(wdt_mcusr);
+        #else
+        persist_restore(MCUSR);
+        MCUSR = 0;
+        #endif
+    #endif
+
+    timer_init();                                   // time base of the boot profile
+
+    #ifdef LED_ON
+        set_bit(LED_DDR, LED1);                      // LED como saída
+        set_led(LED1);
+        led_init();
+    #endif
+    #ifdef WS2812_ON
+        ws2812_init();
+        #ifdef ANIM_ON
+        anim_init();
+        #endif
+    #endif
+    BOOT_STAMP(BOOT_STAGE_LED);
 
     #ifdef USART_ON
         usart_init(MYUBRR,1,1);                         // inicializa a usart
-        VERBOSE_MSG_INIT(usart_send_string("\n\n\nUSART... OK!\n"));
+        #ifdef FAST_BOOT_ON
+            log_mask &= ~LOG_MASK_INIT;                 // banners replaced by the boot profile
+        #endif
+        VERBOSE_MSG_INIT(LOG_STR("\n\n\nUSART... OK!\n"));
     #endif
+    BOOT_STAMP(BOOT_STAGE_USART);
 
-    _delay_ms(200);
+    #ifdef LED_ON
+        VERBOSE_MSG_INIT(LOG_STR("LED... OK!\n"));
+    #else
+        VERBOSE_MSG_INIT(LOG_STR("LED... OFF!\n"));
+    #endif
+
+    #ifdef CONSOLE_ON
+        console_init();
+        VERBOSE_MSG_INIT(LOG_STR("CONSOLE... OK!\n"));
+    #endif
+
+    #ifndef FAST_BOOT_ON
+        for(uint8_t i = 0; i < 20; i++){
+            _delay_ms(10);
+            timer_poll();                               // keeps the boot profile right
+        }
+    #endif
 
     #ifdef WATCHDOG_ON
-        VERBOSE_MSG_INIT(usart_send_string("WATCHDOG..."));
+        wdt_report();
+        VERBOSE_MSG_INIT(LOG_STR("WATCHDOG..."));
         wdt_init();
-        VERBOSE_MSG_INIT(usart_send_string(" OK!\n"));
+        VERBOSE_MSG_INIT(LOG_STR(" OK!\n"));
         wdt_reset();
     #else
-        VERBOSE_MSG_INIT(usart_send_string("WATCHDOG... OFF!\n"));
+        VERBOSE_MSG_INIT(LOG_STR("WATCHDOG... OFF!\n"));
     #endif
+    BOOT_STAMP(BOOT_STAGE_WATCHDOG);
 
     #ifdef WATCHDOG_ON
         wdt_reset();
@@ -30,72 +78,79 @@ void init(void)
     #endif
 
     #ifdef CAN_ON
-        VERBOSE_MSG_INIT(usart_send_string("CAN (500kbps)..."));
-        #ifdef LED_ON
-            set_led(LED1);
-        #endif  
-        can_init(BITRATE_500_KBPS);
+        #ifdef FAST_BOOT_ON
+        // finished by can_app_task(), see can_start_poll()
+        VERBOSE_MSG_INIT(LOG_STR("CAN (" XSTR(CAN_BITRATE) ")... STARTING\n"));
+        can_start(CAN_BITRATE, can_filter);
+        #else
+        VERBOSE_MSG_INIT(LOG_STR("CAN (" XSTR(CAN_BITRATE) ")..."));
+        can_init(CAN_BITRATE);
         //can_set_mode(LOOPBACK_MODE);
-        VERBOSE_MSG_INIT(usart_send_string(" OK!\n"));
-        VERBOSE_MSG_INIT(usart_send_string("CAN filters..."));
+        VERBOSE_MSG_INIT(LOG_STR(" OK!\n"));
+        VERBOSE_MSG_INIT(LOG_STR("CAN filters..."));
         can_static_filter(can_filter);
-        VERBOSE_MSG_INIT(usart_send_string(" OK!\n"));
+        VERBOSE_MSG_INIT(LOG_STR(" OK!\n"));
+        #endif
+        #ifdef LATENCY_ON
+        latency_init();
+        #endif
+        can_app_init();                             // INT wakes the machine
+        #ifdef SR595_ON
+        sr595_init();                               // the spi is up now
+        #endif
     #else
-        VERBOSE_MSG_INIT(usart_send_string("CAN... OFF!\n"));
+        VERBOSE_MSG_INIT(LOG_STR("CAN... OFF!\n"));
     #endif
+    BOOT_STAMP(BOOT_STAGE_CAN);
 
     #ifdef WATCHDOG_ON
         wdt_reset();
     #endif
 
     #ifdef ADC_ON
-        VERBOSE_MSG_INIT(usart_send_string("ADC..."));
+        VERBOSE_MSG_INIT(LOG_STR("ADC..."));
         adc_init();
-        VERBOSE_MSG_INIT(usart_send_string(" OK!\n"));
+        VERBOSE_MSG_INIT(LOG_STR(" OK!\n"));
     #else
-        VERBOSE_MSG_INIT(usart_send_string("ADC... OFF!\n"));
+        VERBOSE_MSG_INIT(LOG_STR("ADC... OFF!\n"));
     #endif
+    BOOT_STAMP(BOOT_STAGE_ADC);
 
     #ifdef WATCHDOG_ON
         wdt_reset();
     #endif
 
     #ifdef SLEEP_ON 
-        VERBOSE_MSG_INIT(usart_send_string("SLEEP..."));
+        VERBOSE_MSG_INIT(LOG_STR("SLEEP..."));
         sleep_init();
-        VERBOSE_MSG_INIT(usart_send_string(" OK!\n"));
+        VERBOSE_MSG_INIT(LOG_STR(" OK!\n"));
     #else
-        VERBOSE_MSG_INIT(usart_send_string("SLEEP... OFF!\n"));
+        VERBOSE_MSG_INIT(LOG_STR("SLEEP... OFF!\n"));
     #endif
+    BOOT_STAMP(BOOT_STAGE_SLEEP);
 
     #ifdef WATCHDOG_ON
         wdt_reset();
     #endif
 
  	#ifdef MACHINE_ON
-        VERBOSE_MSG_INIT(usart_send_string("MACHINE..."));
+        VERBOSE_MSG_INIT(LOG_STR("MACHINE..."));
 		machine_init();
-        VERBOSE_MSG_INIT(usart_send_string(" OK!\n"));
+        VERBOSE_MSG_INIT(LOG_STR(" OK!\n"));
     #else
-        VERBOSE_MSG_INIT(usart_send_string("MACHINE... OFF!\n"));
+        VERBOSE_MSG_INIT(LOG_STR("MACHINE... OFF!\n"));
 	#endif
+    BOOT_STAMP(BOOT_STAGE_MACHINE);
 
     #ifdef WATCHDOG_ON
         wdt_reset();
     #endif
 	
-    #ifdef LED_ON
-        set_bit(LED_DDR, LED1);                      // LED como saída
-        VERBOSE_MSG_INIT(usart_send_string("LED... OK!\n"));
-    #else
-        VERBOSE_MSG_INIT(usart_send_string("LED... OFF!\n"));
-    #endif
-
     #ifdef BUZZER_ON
         set_bit(BUZZER_DDR, BUZZER);                // BUZZER como saída
-        VERBOSE_MSG_INIT(usart_send_string("BUZZER... OK!\n"));
+        VERBOSE_MSG_INIT(LOG_STR("BUZZER... OK!\n"));
     #else
-        VERBOSE_MSG_INIT(usart_send_string("BUZZER... OFF!\n"));
+        VERBOSE_MSG_INIT(LOG_STR("BUZZER... OFF!\n"));
     #endif
 
     #ifdef WATCHDOG_ON
@@ -116,24 +171,46 @@ EXAMPLE OF PIN INIT
     set_bit(CHARGERELAY_DDR, CHARGERELAY);
 */
 
-    VERBOSE_MSG_INIT(usart_send_string("IOs... "));
-    set_bit(MOTOR_ON_OK_PORT, MOTOR_ON_OK);     //Como saida
+    VERBOSE_MSG_INIT(LOG_STR("IOs... "));
+    set_bit(MOTOR_ON_OK_DDR, MOTOR_ON_OK);      //Como saida
     set_bit(MCBS_OK_DDR, MCBS_OK);    //Como saida
+    set_bit(CTRL_SWITCHES_DDR, BOAT_ON_OK);      //Como saida
+    set_bit(CTRL_SWITCHES_DDR, MCC_ON_SWITCH);      //Como saida
+
+#ifndef SR595_ON                                // on the 74HC595 chain instead
     set_bit(REVERSE_SWITCH_DDR, REVERSE_SWITCH);      //Como saida
 
     set_bit(DMS_DDR, DMS);      //Como saida
 
-    set_bit(CTRL_SWITCHES_DDR, BOAT_ON_OK);      //Como saida
     set_bit(CTRL_SWITCHES_DDR, BOAT_ON_SWITCH);      //Como saida
     set_bit(CTRL_SWITCHES_DDR, MOTOR_ON_SWITCH);      //Como saida
-    set_bit(CTRL_SWITCHES_DDR, MCC_ON_SWITCH);      //Como saida
 
     set_bit(POT_ZERO_DDR, POT_ZERO); // COmo saida
+#endif
 
-    VERBOSE_MSG_INIT(usart_send_string("OK!\n"));
+    VERBOSE_MSG_INIT(LOG_STR("OK!\n"));
+    BOOT_STAMP(BOOT_STAGE_IOS);
 
-        
     sei();
+
+    #ifdef FAST_BOOT_ON
+        log_mask |= LOG_MASK_INIT;
+    #endif
+    print_boot_profile();
+}
+
+/**
+ * @brief prints the time each init stage was finished at.
+ */
+void print_boot_profile(void)
+{
+    VERBOSE_MSG_INIT(LOG_FMT("boot profile (%u us per tick): led %u usart %u"
+        " watchdog %u can %u adc %u sleep %u machine %u ios %u\n",
+        TIMER_TICK_US,
+        boot_profile[BOOT_STAGE_LED], boot_profile[BOOT_STAGE_USART],
+        boot_profile[BOOT_STAGE_WATCHDOG], boot_profile[BOOT_STAGE_CAN],
+        boot_profile[BOOT_STAGE_ADC], boot_profile[BOOT_STAGE_SLEEP],
+        boot_profile[BOOT_STAGE_MACHINE], boot_profile[BOOT_STAGE_IOS]));
 }
 
 int main(void)
@@ -142,15 +219,35 @@ int main(void)
 
 	for(;;){
 		#ifdef WATCHDOG_ON
-            wdt_reset();
+            wdt_supervise();
 		#endif
 
         #ifdef MACHINE_ON
             machine_run();
         #endif
 
+        #ifdef LED_ON
+            led_task();
+        #endif
+
+        #ifdef CONSOLE_ON
+            console_task();
+        #endif
+
+        #ifdef DEBOUNCE_PCINT_ON
+            debounce_task();
+        #endif
+
+        #ifdef ANIM_ON
+            anim_task();
+        #endif
+
+        #ifdef SR595_ON
+            sr595_task();
+        #endif
+
 		#ifdef SLEEP_ON
-            sleep_mode();
+            sleep_task();
 		#endif
 	}
 }
@@ -161,10 +258,13 @@ int main(void)
  */
 ISR(BADISR_vect)
 {
+    #ifdef PERSIST_ON
+        persist_crumb(PERSIST_CRUMB_BAD_ISR);
+    #endif
     for(;;){
-        VERBOSE_MSG_ERROR(usart_send_string("\nFATAL ERROR: BAD ISR."));
+        VERBOSE_MSG_ERROR(LOG_STR("\nFATAL ERROR: BAD ISR."));
         #ifdef WATCHDOG_ON
-            VERBOSE_MSG_ERROR(usart_send_string("WAITING FOR WATCHDOG TO RESET...\n"));
+            VERBOSE_MSG_ERROR(LOG_STR("WAITING FOR WATCHDOG TO RESET...\n"));
         #endif
         #ifdef DEBUG_ON
             DEBUG0;
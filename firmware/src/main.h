@@ -21,6 +21,7 @@
 // MODULOS DO SISTEMA
 #include "conf.h"
 #include "dbg_vrb.h"
+#include "timer.h"
 
 #ifdef USART_ON
 #include "usart.h"
@@ -29,6 +30,13 @@
 #pragma message "USART: OFF!"
 #endif /*ifdef USART_ON*/
 
+#ifdef CONSOLE_ON
+#include "console.h"
+#pragma message "CONSOLE: ON!"
+#else
+#pragma message "CONSOLE: OFF!"
+#endif /*ifdef CONSOLE_ON*/
+
 #ifdef CAN_ON
 #include "can.h"
 #include "can_filters.h"
@@ -52,6 +60,7 @@
 #endif /*ifdef MACHINE_ON*/
 
 #ifdef LED_ON
+#include "led.h"
 #pragma message "LED: ON!"
 #else
 #pragma message "LED: OFF!"
@@ -64,6 +73,61 @@
 #pragma message "WATCHDOG: OFF!"
 #endif /*ifdef WATCHDOG_ON*/
 
+#ifdef PERSIST_ON
+#include "persist.h"
+#pragma message "PERSIST: ON!"
+#else
+#pragma message "PERSIST: OFF!"
+#endif /*ifdef PERSIST_ON*/
+
+#ifdef CAN_HEALTH_ON
+#pragma message "CAN_HEALTH: ON!"
+#else
+#pragma message "CAN_HEALTH: OFF!"
+#endif /*ifdef CAN_HEALTH_ON*/
+
+#ifdef DEBOUNCE_ON
+#include "debounce.h"
+#pragma message "DEBOUNCE: ON!"
+#else
+#pragma message "DEBOUNCE: OFF!"
+#endif /*ifdef DEBOUNCE_ON*/
+
+#ifdef LATENCY_ON
+#include "latency.h"
+#pragma message "LATENCY: ON!"
+#else
+#pragma message "LATENCY: OFF!"
+#endif /*ifdef LATENCY_ON*/
+
+#ifdef RECOVERY_ON
+#include "recovery.h"
+#pragma message "RECOVERY: ON!"
+#else
+#pragma message "RECOVERY: OFF!"
+#endif /*ifdef RECOVERY_ON*/
+
+#ifdef WS2812_ON
+#include "ws2812.h"
+#pragma message "WS2812: ON!"
+#else
+#pragma message "WS2812: OFF!"
+#endif /*ifdef WS2812_ON*/
+
+#ifdef ANIM_ON
+#include "anim.h"
+#pragma message "ANIM: ON!"
+#else
+#pragma message "ANIM: OFF!"
+#endif /*ifdef ANIM_ON*/
+
+#ifdef SR595_ON
+#include "sr595.h"
+#pragma message "SR595: ON!"
+#else
+#pragma message "SR595: OFF!"
+#endif /*ifdef SR595_ON*/
+
 #ifdef SLEEP_ON
 #include "sleep.h"
 #pragma message "SLEEP: ON!"
@@ -71,4 +135,24 @@
 #pragma message "SLEEP: OFF!"
 #endif /*ifdef SLEEP_ON*/
 
+typedef enum boot_stages{
+    BOOT_STAGE_LED,
+    BOOT_STAGE_USART,
+    BOOT_STAGE_WATCHDOG,
+    BOOT_STAGE_CAN,
+    BOOT_STAGE_ADC,
+    BOOT_STAGE_SLEEP,
+    BOOT_STAGE_MACHINE,
+    BOOT_STAGE_IOS,
+    BOOT_STAGES,
+} boot_stages_t;
+
+// timer ticks at the end of each init stage
+#define BOOT_STAMP(stage)   do{ timer_poll(); boot_profile[stage] = timer_now(); }while(0)
+
+extern uint16_t boot_profile[BOOT_STAGES];
+
+void init(void);
+void print_boot_profile(void);
+
 #endif /* ifndef MAIN_H */
@@ -0,0 +1,77 @@
+#include "persist.h"
+
+persist_t persist __attribute__((section(".noinit")));
+uint8_t persist_warm;
+
+/**
+ * @brief crc of the block, without the crc itself.
+ */
+static uint16_t persist_crc(void)
+{
+    const uint8_t *p = (const uint8_t *)&persist;
+    uint16_t crc = 0xFFFF;
+
+    for(uint8_t i = 0; i < offsetof(persist_t, crc); i++)
+        crc = _crc16_update(crc, p[i]);
+
+    return crc;
+}
+
+/**
+ * @brief validates the block left by the last run.
+ * @param mcusr is the reset cause, as saved by wdt_first()
+ * @return 1 for a warm restart (the block can be used), 0 otherwise
+ */
+uint8_t persist_restore(uint8_t mcusr)
+{
+    uint8_t cold = !(mcusr & (1 << WDRF))
+        || (mcusr & ((1 << PORF) | (1 << BORF) | (1 << EXTRF)));
+
+    persist_warm = !cold && persist.magic == PERSIST_MAGIC
+        && persist.crc == persist_crc();
+
+    if(persist_warm){
+        persist.warm_restarts++;
+    }else{
+        uint8_t *p = (uint8_t *)&persist;
+        for(uint8_t i = 0; i < sizeof(persist); i++) p[i] = 0;
+        persist.magic = PERSIST_MAGIC;
+    }
+
+    persist.reset_cause = mcusr;
+    persist_crumb(PERSIST_CRUMB_BOOT);
+
+    return persist_warm;
+}
+
+/**
+ * @brief saves the state to be resumed after a watchdog reset.
+ */
+void persist_save(uint8_t state, uint8_t total_errors, uint16_t system_flags)
+{
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+        persist.state = state;
+        persist.total_errors = total_errors;
+        persist.system_flags = system_flags;
+        persist.crc = persist_crc();
+    }
+}
+
+/**
+ * @brief leaves a breadcrumb.
+ */
+void persist_crumb(uint8_t crumb)
+{
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+        persist.crumb[persist.crumb_head++ % PERSIST_CRUMBS] = crumb;
+        persist.crc = persist_crc();
+    }
+}
+
+/**
+ * @brief returns the n-th most recent breadcrumb (0 is the last one).
+ */
+uint8_t persist_last_crumb(uint8_t n)
+{
+    return persist.crumb[(uint8_t)(persist.crumb_head - 1 - n) % PERSIST_CRUMBS];
+}
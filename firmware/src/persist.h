@@ -0,0 +1,60 @@
+/**
+ * @file persist.h
+ *
+ * @defgroup PERSIST Persistent State Module
+ *
+ * @brief State kept in `.noinit` across resets.
+ *
+ * The block is not touched by the startup code, so it survives a watchdog
+ * reset. It is protected by a magic number and a CRC, and is only trusted
+ * after a watchdog reset: power-on, brown-out and external resets start cold.
+ *
+ * On a warm restart the machine resumes the saved state: running resumes
+ * with the saved flags, so the panel is not blanked while the system
+ * re-initializes, and an error keeps being handled with the saved error
+ * count. Once the errors reached MACHINE_ERRORS_TO_RESET the reset was
+ * deliberate and the machine initializes again.
+ *
+ */
+
+#ifndef PERSIST_H
+#define PERSIST_H
+
+#include <stddef.h>
+#include <avr/io.h>
+#include <util/crc16.h>
+#include <util/atomic.h>
+
+#include "conf.h"
+
+#define PERSIST_MAGIC               0x5A17
+
+// breadcrumbs, the checkpoints left before a crash
+#define PERSIST_CRUMB_BOOT          0x01
+#define PERSIST_CRUMB_ERROR         0x02
+#define PERSIST_CRUMB_RESET         0x03
+#define PERSIST_CRUMB_BAD_ISR       0x04
+#define PERSIST_CRUMB_STATE(s)      (0x10 | (s))        //<! entered machine state s
+#define PERSIST_CRUMB_WATCHDOG(m)   (0x20 | (m))        //<! tasks m missed the watchdog
+
+typedef struct persist{
+    uint16_t magic;
+    uint8_t reset_cause;                    //<! MCUSR of the last reset
+    uint8_t warm_restarts;
+    uint8_t total_errors;
+    uint8_t state;                          //<! machine state when saved
+    uint16_t system_flags;
+    uint8_t crumb[PERSIST_CRUMBS];          //<! ring of breadcrumbs
+    uint8_t crumb_head;                     //<! next breadcrumb to be written
+    uint16_t crc;
+} persist_t;
+
+extern persist_t persist;
+extern uint8_t persist_warm;
+
+uint8_t persist_restore(uint8_t mcusr);
+void persist_save(uint8_t state, uint8_t total_errors, uint16_t system_flags);
+void persist_crumb(uint8_t crumb);
+uint8_t persist_last_crumb(uint8_t n);
+
+#endif /* ifndef PERSIST_H */
@@ -0,0 +1,178 @@
+#define LOG_MODULE LOG_MODULE_RECOVERY
+#include "recovery.h"
+#include "machine.h"
+#ifdef CONSOLE_ON
+#include "console.h"
+#endif
+
+recovery_state_t recovery[RECOVERY_SUBSYSTEMS];
+volatile uint8_t recovery_usart_errors;     //<! framing and overrun errors on rx
+
+#define RECOVERY_BACKOFF_MIN    TIMER_MS_TO_TICKS(RECOVERY_BACKOFF_MIN_MS)
+#define RECOVERY_BACKOFF_MAX    TIMER_MS_TO_TICKS(RECOVERY_BACKOFF_MAX_MS)
+
+#if RECOVERY_BACKOFF_MAX_MS > 2000
+#error "RECOVERY_BACKOFF_MAX_MS must fit TIMER_MAX_PERIOD"
+#endif
+
+#ifdef CAN_ON
+static uint8_t recovery_can_healthy(void)
+{
+    if(!can_app_ready()) return 0;              // (re)starting
+
+#ifdef CAN_HEALTH_ON
+    return can_health.state != CAN_HEALTH_BUS_OFF;
+#else
+    return !can_check_bus_off();
+#endif
+}
+
+/**
+ * @brief restarts the controller without blocking: can_app_task() polls it
+ * back to the normal mode, with the static filters, and a controller that
+ * does not answer keeps it unhealthy until the budget is spent.
+ */
+static void recovery_can_recover(void)
+{
+    can_app_restart();
+#ifdef CAN_HEALTH_ON
+    can_health.state = CAN_HEALTH_ACTIVE;       // until the next sample
+#endif
+}
+#endif
+
+#ifdef ADC_ON
+static uint16_t recovery_adc_last;          //<! tick of the last adc frame
+
+static uint8_t recovery_adc_healthy(void)
+{
+    uint16_t now = timer_now();
+
+    if(adc.ready){
+        adc.ready = 0;
+        recovery_adc_last = now;
+    }
+
+    return (uint16_t)(now - recovery_adc_last) < TIMER_MS_TO_TICKS(RECOVERY_ADC_STALL_MS);
+}
+
+/**
+ * @brief reinitializes the adc and its trigger (timer0, or sleep_task() with
+ * ADC_NR_ON). It is healthy again only once a new frame is averaged.
+ */
+static void recovery_adc_recover(void)
+{
+    uint8_t ddrc = DDRC, portc = PORTC;
+
+    adc_init();
+    DDRC = ddrc;                                // pins shared with the indicators
+    PORTC = portc;
+}
+#endif
+
+static uint8_t recovery_usart_healthy(void)
+{
+    uint8_t errors = recovery_usart_errors;
+    recovery_usart_errors = 0;
+
+    return errors < RECOVERY_USART_ERRORS
+        && bit_is_set(UCSR0B, TXEN0) && bit_is_set(UCSR0B, RXEN0);
+}
+
+static void recovery_usart_recover(void)
+{
+    usart_init(MYUBRR,1,1);
+    while(USART_HAS_DATA) (void)UDR0;          // flush
+#ifdef CONSOLE_ON
+    console_init();
+#endif
+}
+
+static const recovery_subsystem_t recovery_subsystems[RECOVERY_SUBSYSTEMS] PROGMEM = {
+#ifdef CAN_ON
+    [RECOVERY_CAN]      = {&recovery_can_healthy,   &recovery_can_recover,
+                            TIMER_MS_TO_TICKS(RECOVERY_CAN_BACKOFF_MS),     RECOVERY_CAN_BUDGET},
+#endif
+#ifdef ADC_ON
+    [RECOVERY_ADC]      = {&recovery_adc_healthy,   &recovery_adc_recover,
+                            TIMER_MS_TO_TICKS(RECOVERY_ADC_BACKOFF_MS),     RECOVERY_ADC_BUDGET},
+#endif
+    [RECOVERY_USART]    = {&recovery_usart_healthy, &recovery_usart_recover,
+                            RECOVERY_BACKOFF_MIN,                           RECOVERY_USART_BUDGET},
+};
+
+/**
+ * @brief raises the error flag of a subsystem that ran out of budget.
+ */
+static void recovery_escalate(recovery_subsystems_t n)
+{
+    switch(n){
+        case RECOVERY_CAN:      error_flags.no_canbus = 1;  break;
+        case RECOVERY_ADC:      error_flags.adc_stall = 1;  break;
+        case RECOVERY_USART:    error_flags.usart = 1;      break;
+        default:                                            break;
+    }
+}
+
+void recovery_init(void)
+{
+    uint16_t now = timer_now();
+
+    for(uint8_t i = 0; i < RECOVERY_SUBSYSTEMS; i++){
+        recovery[i].next = now + RECOVERY_BACKOFF_MIN;
+        recovery[i].backoff = RECOVERY_BACKOFF_MIN;
+        recovery[i].attempts = recovery[i].failing = 0;
+    }
+
+#ifdef ADC_ON
+    recovery_adc_last = now;
+#endif
+}
+
+/**
+ * @brief checks the subsystems that are due and runs their recovery.
+ */
+void recovery_task(void)
+{
+    uint16_t now = timer_now();
+
+    for(uint8_t i = 0; i < RECOVERY_SUBSYSTEMS; i++){
+        recovery_state_t *r = &recovery[i];
+        recovery_subsystem_t s;
+
+        memcpy_P(&s, &recovery_subsystems[i], sizeof(s));
+        if(!s.healthy) continue;                    // not built
+
+        if((int16_t)(now - r->next) < 0) continue;
+
+        if(s.healthy()){
+            if(r->failing)
+                VERBOSE_MSG_ERROR(LOG_FMT("recovery: %u ok after %u attempts\n", i, r->attempts));
+            r->failing = r->attempts = 0;
+            r->next = now + RECOVERY_BACKOFF_MIN;
+            continue;
+        }
+
+        if(!r->failing){                            // gives it a chance first
+            r->failing = 1;
+            r->backoff = s.backoff;
+            r->next = now + r->backoff;
+            continue;
+        }
+
+        if(r->attempts >= s.budget){
+            recovery_escalate(i);
+            r->next = now + r->backoff;
+            continue;
+        }
+
+        VERBOSE_MSG_ERROR(LOG_FMT("recovery: %u attempt %u\n", i, r->attempts));
+        s.recover();
+        r->attempts++;
+        r->recoveries++;
+        r->next = now + r->backoff;
+
+        r->backoff <<= 1;
+        if(r->backoff > RECOVERY_BACKOFF_MAX) r->backoff = RECOVERY_BACKOFF_MAX;
+    }
+}
@@ -0,0 +1,55 @@
+/**
+ * @file recovery.h
+ *
+ * @defgroup RECOVERY Fault Recovery Module
+ *
+ * @brief Reinitializes only the subsystem that failed.
+ *
+ * Each subsystem has a health check and a recovery action. When the check
+ * fails, the subsystem gets one backoff to recover by itself; if it is still
+ * failing the action is run and the check is done again after a backoff that
+ * doubles on every attempt (up to RECOVERY_BACKOFF_MAX_MS). Only when a
+ * subsystem spends its budget of consecutive attempts its error flag is
+ * raised, and the machine goes through the error state (and, if it keeps
+ * failing, to the reset).
+ *
+ */
+
+#ifndef RECOVERY_H
+#define RECOVERY_H
+
+#include <avr/io.h>
+
+#include "conf.h"
+#include "dbg_vrb.h"
+#include "timer.h"
+
+typedef enum recovery_subsystems{
+    RECOVERY_CAN,
+    RECOVERY_ADC,
+    RECOVERY_USART,
+    RECOVERY_SUBSYSTEMS,
+} recovery_subsystems_t;
+
+typedef struct{
+    uint8_t (*healthy)(void);
+    void (*recover)(void);
+    uint16_t backoff;                       //<! first backoff, in ticks
+    uint8_t budget;                         //<! consecutive attempts before escalating
+} recovery_subsystem_t;
+
+typedef struct{
+    uint16_t next;                          //<! tick of the next check
+    uint16_t backoff;                       //<! in ticks
+    uint8_t attempts;                       //<! since it was last healthy
+    uint8_t failing;
+    uint16_t recoveries;                    //<! total, for the stats
+} recovery_state_t;
+
+extern recovery_state_t recovery[RECOVERY_SUBSYSTEMS];
+extern volatile uint8_t recovery_usart_errors;
+
+void recovery_init(void);
+void recovery_task(void);
+
+#endif /* ifndef RECOVERY_H */
@@ -0,0 +1,99 @@
+#include "sleep.h"
+#ifdef LED_ON
+#include "led.h"
+#endif
+#ifdef CAN_ON
+#include "can_app.h"
+#endif
+
+#ifdef ADC_NR_ON
+sleep_stats_t sleep_stats;
+volatile uint8_t sleep_rx_active;
+volatile uint16_t sleep_rx_stamp;
+
+#define SLEEP_ADC_TICKS     ((ADC_CONVERSION_CYCLES / TIMER_PRESCALER) + 1 + TIMER_MIN_LEAD)
+
+/**
+ * @brief the policy: whether every clock but the adc one can be stopped for
+ * a conversion. Must be called with interrupts off.
+ */
+static uint8_t sleep_adc_allowed(void)
+{
+    if(bit_is_set(ADCSRA, ADSC))                    // one is running already
+        return 0;
+
+#ifdef LED_ON
+    if(led_pwm_active())                            // a pin is mid-duty
+        return 0;
+#endif
+
+#ifdef USART_ON
+    // a frame being shifted out or in would be corrupted
+    if(!usart_tx_idle){
+        if(bit_is_clear(UCSR0A, TXC0))
+            return 0;
+        usart_tx_idle = 1;
+    }
+    if(bit_is_set(UCSR0A, RXC0))
+        return 0;
+    if(sleep_rx_active){
+        if((uint16_t)(timer_now() - sleep_rx_stamp) < TIMER_MS_TO_TICKS(ADC_NR_RX_QUIET_MS))
+            return 0;
+        sleep_rx_active = 0;
+    }
+#endif
+
+    // a deadline would be late by a whole conversion
+    return timer_idle() > SLEEP_ADC_TICKS;
+}
+#endif
+
+void sleep_init(void)
+{
+	set_sleep_mode(SLEEP_MODE_IDLE);
+}
+
+/**
+ * @brief sleeps until the next interrupt, doing one adc conversion with
+ * ADC_NR_ON.
+ */
+void sleep_task(void)
+{
+    cli();
+#ifdef CAN_ON
+    if(can_app_rx_pending()){                       // a frame came after machine_run()
+        sei();
+        return;
+    }
+#endif
+
+#ifdef ADC_NR_ON
+    if(sleep_adc_allowed()){
+        adc.converted = 0;
+        set_sleep_mode(SLEEP_MODE_ADC);             // entering it starts the conversion
+        sleep_enable();
+        sei();
+        sleep_cpu();
+        sleep_disable();
+        set_sleep_mode(SLEEP_MODE_IDLE);
+
+        if(adc.converted){
+            timer_skip(ADC_CONVERSION_CYCLES);      // timer2 was stopped meanwhile
+            sleep_stats.adc_sleeps++;
+        }else{
+            sleep_stats.early_wakes++;              // unknown, at most one conversion
+        }
+        return;
+    }
+
+    if(bit_is_clear(ADCSRA, ADSC)){
+        set_bit(ADCSRA, ADSC);
+        sleep_stats.idle_sleeps++;
+    }
+#endif
+
+    sleep_enable();
+    sei();                                          // the next instruction runs first
+    sleep_cpu();
+    sleep_disable();
+}
@@ -1,11 +1,18 @@
 /**
- * @file watchdog.h
+ * @file sleep.h
  *
  * @defgroup SLEEP Sleep Module
  *
  * @brief A simple sleep module. Note that some interruption should be
  * configured to wake the device even in SLEEP_MODE_IDLE.
  *
+ * With ADC_NR_ON the adc is not triggered by timer0: each sleep starts one
+ * conversion. When sleep_adc_allowed() finds nothing that needs the I/O
+ * clock (the led pwm of a mid-duty pin, a usart frame, a timer deadline
+ * within the conversion) it is done in SLEEP_MODE_ADC, with the CPU and I/O
+ * clocks stopped, and the timer service is told how long timer2 was stopped.
+ * Otherwise it is started by hand and the CPU sleeps in SLEEP_MODE_IDLE as
+ * before. sleep_stats counts both.
  *
  */
 
@@ -14,10 +21,28 @@
 
 #include <avr/io.h>
 #include <avr/sleep.h>
+#include <avr/interrupt.h>
 
-void sleep_init(void)
-{
-	set_sleep_mode(SLEEP_MODE_IDLE);
-}
+#include "conf.h"
+#include "../lib/bit_utils.h"
+#ifdef ADC_NR_ON
+#include "timer.h"
+#include "adc.h"
+#endif
+
+#ifdef ADC_NR_ON
+typedef struct{
+    uint16_t adc_sleeps;                    //<! conversions in SLEEP_MODE_ADC
+    uint16_t idle_sleeps;                   //<! conversions in SLEEP_MODE_IDLE
+    uint16_t early_wakes;                   //<! adc sleeps ended by other interrupts
+} sleep_stats_t;
+
+extern sleep_stats_t sleep_stats;
+extern volatile uint8_t sleep_rx_active;    //<! set by the usart rx isr
+extern volatile uint16_t sleep_rx_stamp;
+#endif
+
+void sleep_init(void);
+void sleep_task(void);
 
 #endif /* ifndef SLEEP_H */
@@ -0,0 +1,38 @@
+#include "spi_bus.h"
+
+volatile spi_bus_t spi_bus;
+
+/**
+ * @brief takes the bus and loads the device settings.
+ * @return 1 if taken, 0 if the bus is in use (by the can-lib or another
+ * device) and the transaction must be retried later
+ */
+uint8_t spi_bus_begin(spi_bus_owner_t owner, const spi_bus_device_t *dev)
+{
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+        if(spi_bus.owner != SPI_BUS_FREE || bit_is_clear(CAN_CS_PORT, CAN_CS)
+                || bit_is_clear(SPCR, SPE)){        // not set up yet
+            spi_bus.busy++;
+            return 0;
+        }
+        spi_bus.owner = owner;
+    }
+
+    spi_bus.spcr = SPCR;
+    spi_bus.spsr = SPSR & (1 << SPI2X);
+    SPCR = dev->spcr;
+    SPSR = dev->spsr;
+    (void)SPDR;                                     // drops a stale SPIF
+
+    return 1;
+}
+
+/**
+ * @brief puts the can-lib settings back and frees the bus.
+ */
+void spi_bus_end(void)
+{
+    SPCR = spi_bus.spcr;
+    SPSR = spi_bus.spsr;
+    spi_bus.owner = SPI_BUS_FREE;
+}
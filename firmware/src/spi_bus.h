@@ -0,0 +1,62 @@
+/**
+ * @file spi_bus.h
+ *
+ * @defgroup SPI_BUS SPI Bus Sharing Module
+ *
+ * @brief Lets other devices use the hardware SPI that the can-lib set up
+ * for the MCP2515.
+ *
+ * A transaction takes the bus, loads the device SPI settings and puts the
+ * can-lib ones back when it ends. The can-lib does not take the bus itself:
+ * its transactions are seen by the MCP2515 chip select being low, so a
+ * transaction started from an interrupt that preempted one of them fails
+ * instead of corrupting it, and the caller retries later. Between its
+ * transactions the can-lib sees the bus as it left it.
+ *
+ */
+
+#ifndef SPI_BUS_H
+#define SPI_BUS_H
+
+#include <avr/io.h>
+#include <util/atomic.h>
+
+#include "conf.h"
+#include "../lib/bit_utils.h"
+
+#ifndef SPI_ON
+#error "the spi bus is set up by the can-lib, it needs SPI_ON"
+#endif
+
+typedef enum spi_bus_owners{
+    SPI_BUS_FREE,
+    SPI_BUS_SR595,
+} spi_bus_owner_t;
+
+typedef struct{
+    uint8_t spcr;
+    uint8_t spsr;                           //<! only SPI2X is writable
+} spi_bus_device_t;
+
+typedef struct spi_bus{
+    spi_bus_owner_t owner;
+    uint8_t spcr;                           //<! can-lib settings, put back by spi_bus_end()
+    uint8_t spsr;
+    uint16_t busy;                          //<! transactions refused
+} spi_bus_t;
+
+extern volatile spi_bus_t spi_bus;
+
+uint8_t spi_bus_begin(spi_bus_owner_t owner, const spi_bus_device_t *dev);
+void spi_bus_end(void);
+
+/**
+ * @brief sends one byte and waits for it. Only inside a transaction.
+ */
+static inline void spi_bus_put(uint8_t data)
+{
+    SPDR = data;
+    while(!(SPSR & (1 << SPIF)));
+}
+
+#endif /* ifndef SPI_BUS_H */
@@ -0,0 +1,77 @@
+#include "sr595.h"
+#ifdef SR595_ON
+
+volatile sr595_t sr595;
+
+/**
+ * @brief mode 0, as the MCP2515, at F_CPU/2.
+ */
+static const spi_bus_device_t sr595_spi = {
+    .spcr = (1 << SPE) | (1 << MSTR),
+    .spsr = (1 << SPI2X),
+};
+
+/**
+ * @brief sets the latch pin and clears every output. The spi must be
+ * already set up by the can-lib.
+ */
+void sr595_init(void)
+{
+    clr_bit(SR595_LATCH_PORT, SR595_LATCH);
+    set_bit(SR595_LATCH_DDR, SR595_LATCH);
+
+    for(uint8_t i = 0; i < SR595_CHIPS; i++) sr595.out[i] = 0;
+    sr595.bursts = sr595.deferred = 0;
+    sr595.dirty = 1;
+    sr595_flush();
+}
+
+/**
+ * @brief changes the masked outputs of one chip in the image.
+ */
+void sr595_write(uint8_t chip, uint8_t mask, uint8_t value)
+{
+    if(chip >= SR595_CHIPS) return;
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+        uint8_t out = (sr595.out[chip] & ~mask) | (value & mask);
+        if(out != sr595.out[chip]){
+            sr595.out[chip] = out;
+            sr595.dirty = 1;
+        }
+    }
+}
+
+/**
+ * @brief sends the image, farthest chip first, and latches it.
+ * @return 0 if the bus was busy and the image is still to be sent
+ */
+uint8_t sr595_flush(void)
+{
+    if(!sr595.dirty) return 1;
+
+    if(!spi_bus_begin(SPI_BUS_SR595, &sr595_spi)){
+        sr595.deferred++;
+        return 0;
+    }
+
+    sr595.dirty = 0;                                // a write meanwhile sets it again
+    for(uint8_t i = SR595_CHIPS; i--; )
+        spi_bus_put(sr595.out[i]);
+
+    set_bit(SR595_LATCH_PORT, SR595_LATCH);         // RCLK rising edge
+    clr_bit(SR595_LATCH_PORT, SR595_LATCH);
+
+    spi_bus_end();
+    sr595.bursts++;
+    return 1;
+}
+
+/**
+ * @brief retries a refused flush.
+ */
+void sr595_task(void)
+{
+    if(sr595.dirty) sr595_flush();
+}
+#endif
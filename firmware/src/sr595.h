@@ -0,0 +1,48 @@
+/**
+ * @file sr595.h
+ *
+ * @defgroup SR595 Shift Register Output Module
+ *
+ * @brief Output expander of chained 74HC595s on the shared SPI bus.
+ *
+ * The chain gets SCK and MOSI, with its own latch on SR595_LATCH (RCLK),
+ * /OE tied low and /SRCLR tied high. The last QH' must not go to MISO, the
+ * MCP2515 drives it. The shift registers also clock in the CAN traffic, but
+ * the outputs only change on the latch pulse after a burst of the whole
+ * image, so they never show it.
+ *
+ * The outputs are kept in an SRAM image, chip 0 being the one next to the
+ * microcontroller. sr595_write() only changes the image, and sr595_flush()
+ * sends it if anything changed, in one burst of SR595_CHIPS bytes at
+ * F_CPU/2 (about 1 us per chip). A flush refused by the bus is retried by
+ * sr595_task().
+ *
+ */
+
+#ifndef SR595_H
+#define SR595_H
+
+#include <avr/io.h>
+#include <util/atomic.h>
+
+#include "conf.h"
+#include "spi_bus.h"
+#include "../lib/bit_utils.h"
+
+#ifdef SR595_ON
+typedef struct sr595{
+    uint8_t out[SR595_CHIPS];               //<! output image, chip 0 first
+    uint8_t dirty;                          //<! image not sent yet
+    uint16_t bursts;
+    uint16_t deferred;                      //<! flushes refused by the bus
+} sr595_t;
+
+extern volatile sr595_t sr595;
+
+void sr595_init(void);
+void sr595_write(uint8_t chip, uint8_t mask, uint8_t value);
+uint8_t sr595_flush(void);
+void sr595_task(void);
+#endif
+
+#endif /* ifndef SR595_H */
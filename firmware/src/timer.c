@@ -0,0 +1,282 @@
+#include "timer.h"
+
+volatile timer_service_t timer;
+
+/**
+ * @brief reads the 16-bit tick count. Must be called with interrupts off.
+ * If TCNT2 has just wrapped and the overflow was not serviced yet, the high
+ * byte is corrected here.
+ */
+static inline uint16_t timer_hw_unsafe(void)
+{
+    uint8_t low = TCNT2;
+    uint8_t high = timer.ovf;
+
+    if(bit_is_set(TIFR2, TOV2) && (low < 0x80)) high++;
+
+    return ((uint16_t)high << 8) | low;
+}
+
+/**
+ * @brief the tick count: timer2 plus the ticks it missed while stopped.
+ * Must be called with interrupts off.
+ */
+static inline uint16_t timer_now_unsafe(void)
+{
+    return timer_hw_unsafe() + timer.offset;
+}
+
+/**
+ * @brief marks the due jobs as pending, reloads the periodic ones and arms
+ * OCR2A for the nearest deadline. Must be called with interrupts off.
+ *
+ * If the nearest deadline is not inside the current 256-tick page the
+ * compare interrupt is disabled and the overflow interrupt takes care of it.
+ */
+static void timer_dispatch(void)
+{
+    for(;;){
+        uint16_t now = timer_now_unsafe();
+        uint16_t next = 0;
+        int16_t next_dt = TIMER_MAX_PERIOD;
+        uint8_t armed = 0;
+
+        for(uint8_t i = 0, bit = 1; i < TIMER_JOBS; i++, bit <<= 1){
+            if(!(timer.enabled & bit)) continue;
+
+            int16_t dt = (int16_t)(timer.job[i].deadline - now);
+            if(dt <= 0){
+                timer.pending |= bit;
+                if(!timer.job[i].period){
+                    timer.enabled &= ~bit;              // one-shot
+                    continue;
+                }
+                timer.job[i].deadline += timer.job[i].period;
+                dt = (int16_t)(timer.job[i].deadline - now);
+                if(dt <= 0){                            // lagging behind, resync
+                    timer.job[i].deadline = now + timer.job[i].period;
+                    dt = timer.job[i].period;
+                }
+            }
+
+            if(!armed || dt < next_dt){
+                next_dt = dt;
+                next = timer.job[i].deadline;
+                armed = 1;
+            }
+        }
+
+        // OCR2A compares against timer2 itself, without the offset
+        uint16_t hw_next = next - timer.offset;
+        uint16_t hw_now = now - timer.offset;
+
+        if(!armed || (hw_next >> 8) != (hw_now >> 8)){
+            clr_bit(TIMSK2, OCIE2A);                    // wait for the overflow
+            return;
+        }
+
+        if(next_dt >= TIMER_MIN_LEAD){
+            OCR2A = LOW(hw_next);
+            TIFR2 = (1 << OCF2A);                       // drops a stale match
+            set_bit(TIMSK2, OCIE2A);
+            return;
+        }
+
+        // too close to be armed: let it expire and dispatch again
+        while((int16_t)(next - timer_now_unsafe()) > 0);
+    }
+}
+
+/**
+ * @brief starts Timer2 as a free running counter with the overflow and
+ * compare interrupts driving the deadlines.
+ */
+void timer_init(void)
+{
+    //clr_bit(PRR, PRTIM2);                          // Activates clock
+
+    // MODE 0 -> Normal, free running
+    TCCR2A  =   (0 << WGM21) | (0 << WGM20)         // mode 0
+            | (0 << COM2B1) | (0 << COM2B0)         // do nothing
+            | (0 << COM2A1) | (0 << COM2A0);        // do nothing
+
+    TCCR2B  =
+#if TIMER_PRESCALER ==     1
+                (0 << CS22) | (0 << CS21) | (1 << CS20) // Prescaler N=1
+#elif TIMER_PRESCALER ==   8
+                (0 << CS22) | (1 << CS21) | (0 << CS20) // Prescaler N=8
+#elif TIMER_PRESCALER ==   32
+                (0 << CS22) | (1 << CS21) | (1 << CS20) // Prescaler N=32
+#elif TIMER_PRESCALER ==   64
+                (1 << CS22) | (0 << CS21) | (0 << CS20) // Prescaler N=64
+#elif TIMER_PRESCALER ==   128
+                (1 << CS22) | (0 << CS21) | (1 << CS20) // Prescaler N=128
+#elif TIMER_PRESCALER ==   256
+                (1 << CS22) | (1 << CS21) | (0 << CS20) // Prescaler N=256
+#elif TIMER_PRESCALER ==   1024
+                (1 << CS22) | (1 << CS21) | (1 << CS20) // Prescaler N=1024
+#else
+                0
+#endif
+                | (0 << WGM22);                     // mode 0
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+        timer.enabled = timer.pending = timer.ovf = 0;
+        timer.offset = timer.skip = 0;
+        TCNT2 = 0;
+        TIFR2 = (1 << OCF2A) | (1 << TOV2);
+        TIMSK2 = (1 << TOIE2);                      // overflow extends TCNT2
+    }
+}
+
+/**
+ * @brief takes a pending overflow by polling. Only needed while the
+ * interrupts are still off (e.g. during the boot), and then it must be called
+ * at least once every 256 ticks.
+ */
+void timer_poll(void)
+{
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+        if(bit_is_set(TIFR2, TOV2)){
+            TIFR2 = (1 << TOV2);
+            timer.ovf++;
+        }
+    }
+}
+
+/**
+ * @brief returns the current tick count (TIMER_FREQUENCY ticks per second).
+ */
+uint16_t timer_now(void)
+{
+    uint16_t now;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+        now = timer_now_unsafe();
+    }
+    return now;
+}
+
+/**
+ * @brief arms a job.
+ * @param job is the job to be armed
+ * @param delay is the number of ticks until the first deadline
+ * @param period is the reload in ticks, 0 for a one-shot job
+ */
+void timer_start(timer_jobs_t job, uint16_t delay, uint16_t period)
+{
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+        timer.job[job].deadline = timer_now_unsafe() + delay;
+        timer.job[job].period = period;
+        timer.pending &= ~(1 << job);
+        timer.enabled |= (1 << job);
+        timer_dispatch();
+    }
+}
+
+/**
+ * @brief disarms a job and drops it if pending.
+ */
+void timer_stop(timer_jobs_t job)
+{
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+        timer.enabled &= ~(1 << job);
+        timer.pending &= ~(1 << job);
+        timer_dispatch();
+    }
+}
+
+/**
+ * @brief returns the period of an armed job, 0 if disarmed or one-shot.
+ */
+uint16_t timer_period(timer_jobs_t job)
+{
+    uint16_t period = 0;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+        if(timer.enabled & (1 << job)) period = timer.job[job].period;
+    }
+    return period;
+}
+
+/**
+ * @brief consumes a due job.
+ * @return 1 if the job was due since the last call, 0 otherwise
+ */
+uint8_t timer_take(timer_jobs_t job)
+{
+    uint8_t due;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+        due = timer.pending & (1 << job);
+        timer.pending &= ~(1 << job);
+    }
+    return due ? 1 : 0;
+}
+
+/**
+ * @brief peeks a due job without consuming it.
+ */
+uint8_t timer_due(timer_jobs_t job)
+{
+    return (timer.pending & (1 << job)) ? 1 : 0;
+}
+
+/**
+ * @brief returns 1 if the job is armed or due and not taken yet.
+ */
+uint8_t timer_armed(timer_jobs_t job)
+{
+    return ((timer.enabled | timer.pending) & (1 << job)) ? 1 : 0;
+}
+
+/**
+ * @brief returns the ticks until the nearest deadline, TIMER_MAX_PERIOD if
+ * none is armed.
+ */
+uint16_t timer_idle(void)
+{
+    int16_t idle = TIMER_MAX_PERIOD;
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+        uint16_t now = timer_now_unsafe();
+
+        if(timer.pending) idle = 0;
+        for(uint8_t i = 0, bit = 1; i < TIMER_JOBS; i++, bit <<= 1){
+            if(!(timer.enabled & bit)) continue;
+            int16_t dt = (int16_t)(timer.job[i].deadline - now);
+            if(dt < idle) idle = dt;
+        }
+    }
+    return idle > 0 ? idle : 0;
+}
+
+/**
+ * @brief accounts for cpu cycles in which timer2 was stopped (e.g. the adc
+ * noise reduction sleep), so the tick count keeps the real time.
+ */
+void timer_skip(uint16_t cycles)
+{
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+        timer.skip += cycles;
+        if(timer.skip >= TIMER_PRESCALER){
+            timer.offset += timer.skip / TIMER_PRESCALER;
+            timer.skip %= TIMER_PRESCALER;
+            timer_dispatch();                           // something may be due now
+        }
+    }
+}
+
+/**
+ * @brief extends TCNT2 and handles the deadlines outside the current page.
+ */
+ISR(TIMER2_OVF_vect)
+{
+    timer.ovf++;
+    timer_dispatch();
+}
+
+/**
+ * @brief nearest deadline reached.
+ */
+ISR(TIMER2_COMPA_vect)
+{
+    timer_dispatch();
+}
@@ -0,0 +1,78 @@
+/**
+ * @file timer.h
+ *
+ * @defgroup TIMER Tickless Timer Module
+ *
+ * @brief Deadline based timer service running on Timer2.
+ *
+ * Timer2 is left free running and its 8-bit counter is extended to 16 bits
+ * in software by the overflow interrupt. Each job owns a deadline (and an
+ * optional period) and OCR2A is programmed only for the nearest one, so the
+ * CPU is woken up when something is actually due instead of at a fixed rate.
+ *
+ */
+
+#ifndef TIMER_H
+#define TIMER_H
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <util/atomic.h>
+
+#include "conf.h"
+#include "../lib/bit_utils.h"
+
+#define TIMER_PRESCALER         MACHINE_TIMER_PRESCALER
+#define TIMER_FREQUENCY         ((F_CPU) / (TIMER_PRESCALER))   //<! tick rate in Hz
+#define TIMER_HZ_TO_TICKS(f)    ((uint16_t)((TIMER_FREQUENCY) / (f)))
+#define TIMER_MS_TO_TICKS(ms)   ((uint16_t)(((uint32_t)(TIMER_FREQUENCY) * (ms)) / 1000))
+#define TIMER_TICK_US           ((uint16_t)(1000000UL / (TIMER_FREQUENCY)))
+#define TIMER_MACHINE_TICKS(n)  ((uint16_t)(((uint32_t)(n) * (TIMER_FREQUENCY)) / (MACHINE_FREQUENCY)))
+
+#define TIMER_MAX_PERIOD        0x7FFF  //<! deadlines are compared as int16_t
+#define TIMER_MIN_LEAD          2       //<! minimum ticks ahead to arm OCR2A
+
+#if ((TIMER_FREQUENCY) / (MACHINE_FREQUENCY)) == 0
+#error "MACHINE_FREQUENCY is too high for TIMER_PRESCALER"
+#endif
+
+typedef enum timer_jobs{
+    TIMER_JOB_MACHINE,                      //<! machine_run() supervision tick
+    TIMER_JOB_INFOS,                        //<! print_infos() telemetry
+    TIMER_JOB_CAN_HEALTH,                   //<! can_health_task() sampling
+    TIMER_JOB_DEBOUNCE,                     //<! debounce_task() while an input is moving
+    TIMER_JOB_ANIM,                         //<! anim_task() while an animation plays
+    TIMER_JOB_LED,                          //<! led_task() for the on/off patterns
+    TIMER_JOB_CAN_TIMEOUT,                  //<! earliest can module rx timeout
+    TIMER_JOBS,
+} timer_jobs_t;
+
+typedef struct{
+    uint16_t deadline;
+    uint16_t period;                        //<! 0 for one-shot jobs
+} timer_job_t;
+
+typedef struct timer{
+    timer_job_t job[TIMER_JOBS];
+    uint8_t enabled;                        //<! bitmap of armed jobs
+    uint8_t pending;                        //<! bitmap of due jobs not yet taken
+    uint8_t ovf;                            //<! software extension of TCNT2
+    uint16_t offset;                        //<! ticks lost while timer2 was stopped
+    uint16_t skip;                          //<! cycles not yet added to offset
+} timer_service_t;
+
+extern volatile timer_service_t timer;
+
+void timer_init(void);
+void timer_poll(void);
+uint16_t timer_now(void);
+void timer_start(timer_jobs_t job, uint16_t delay, uint16_t period);
+void timer_stop(timer_jobs_t job);
+uint16_t timer_period(timer_jobs_t job);
+uint8_t timer_take(timer_jobs_t job);
+uint8_t timer_due(timer_jobs_t job);
+uint8_t timer_armed(timer_jobs_t job);
+uint16_t timer_idle(void);
+void timer_skip(uint16_t cycles);
+
+#endif /* ifndef TIMER_H */
@@ -1,5 +1,9 @@
 #include "usart.h"
 
+#ifdef ADC_NR_ON
+volatile uint8_t usart_tx_idle;
+#endif
+
 /**
  * @brief sends a char through serial
  * @param data will be sent trough serial
@@ -7,6 +11,11 @@
 inline void usart_send_char(char data)
 {
     while(!(UCSR0A & (1<<UDRE0)));
+#ifdef ADC_NR_ON
+    // TXC0 tells sleep_task() when this frame is out
+    UCSR0A = (UCSR0A & ((1<<U2X0) | (1<<MPCM0))) | (1<<TXC0);
+    usart_tx_idle = 0;
+#endif
     UDR0 = data;
 }
 
@@ -29,6 +38,16 @@ inline void usart_send_string(const char *s)
     while(s[i] != '\0') usart_send_char(s[i++]);
 }
 
+/**
+ * @brief sends a char array stored in flash (PROGMEM) trough serial.
+ * The strings MUST terminate with '\0'.
+ */
+inline void usart_send_string_P(const char *s)
+{
+    char c;
+    while((c = pgm_read_byte(s++)) != '\0') usart_send_char(c);
+}
+
 /**
 * @brief sends a number in ascii trough serial.
 * The number could be represent with left-filled with a defined FILL char in 
@@ -222,5 +241,9 @@ inline void usart_init(uint16_t ubrr, uint8_t rx, uint8_t tx)
     
     // Enable RX and TX
     UCSR0B = ((rx&1)<<RXEN0) | ((tx&1)<<TXEN0);
+
+#ifdef ADC_NR_ON
+    usart_tx_idle = 1;                  // TXC0 is clear until the first frame
+#endif
 }
 
@@ -12,6 +12,7 @@
 #define USART_H
 
 #include <avr/io.h>
+#include <avr/pgmspace.h>
 #include "../lib/bit_utils.h"
 #include "conf.h"
 
@@ -23,11 +24,16 @@
 #define   USART_HAS_DATA   bit_is_set(UCSR0A, RXC0)
 #define   USART_READY      bit_is_set(UCSR0A, UDRE0)
 
+#ifdef ADC_NR_ON
+extern volatile uint8_t usart_tx_idle;  //<! nothing sent since the last TXC0
+#endif
+
 void usart_send_char(char data);
 
 char usart_receive_char(void);
 
 void usart_send_string(const char *s);
+void usart_send_string_P(const char *s);
 
 void usart_send_int8(int8_t num);
 void usart_send_uint8(uint8_t num);
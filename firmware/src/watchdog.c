@@ -0,0 +1,103 @@
+#define LOG_MODULE LOG_MODULE_WATCHDOG
+#include "watchdog.h"
+
+/**
+ * @brief reset cause (MCUSR), saved before it is cleared.
+ */
+uint8_t wdt_mcusr __attribute__((section(".noinit")));
+
+/**
+ * @brief tasks that missed their check-in on the last watchdog time-out.
+ */
+uint8_t wdt_missed __attribute__((section(".noinit")));
+
+/**
+ * @brief This function is called upon a HARDWARE RESET:
+ */
+void wdt_first(void)
+{
+    wdt_mcusr = MCUSR;
+    MCUSR = 0; // clear reset flags
+    wdt_disable();
+    //http://www.atmel.com/webdoc/AVRLibcReferenceManual/FAQ_1faq_softreset.html
+}
+
+/**	
+ * @brief initialize watchdog in the interrupt and reset mode with the
+ * WDT_TIMEOUT time-out.
+ */
+void wdt_init(void)
+{
+    WDT_CHECKINS = 0;
+
+    cli();
+    wdt_reset();
+    WDTCSR = (1 << WDCE) | (1 << WDE);             // timed sequence
+    WDTCSR = (1 << WDIE) | (1 << WDE)
+            | ((WDT_TIMEOUT & 0x08) ? (1 << WDP3) : 0)
+            | (WDT_TIMEOUT & 0x07);
+    // interrupts are enabled at the end of init()
+}
+
+/**
+ * @brief feeds the watchdog if every task checked in since the last time.
+ */
+void wdt_supervise(void)
+{
+    if((WDT_CHECKINS & WDT_TASKS_MASK) != WDT_TASKS_MASK) return;
+
+    WDT_CHECKINS = 0;
+    wdt_reset();
+    WDTCSR |= (1 << WDIE);                          // re-arms the interrupt
+}
+
+/**
+ * @brief resets the system as fast as the watchdog allows.
+ */
+void wdt_fast_reset(void)
+{
+    cli();
+    wdt_enable(WDTO_15MS);                          // plain reset mode
+    for(;;);
+}
+
+/**
+ * @brief logs the tasks that missed their check-in before the watchdog reset,
+ * as noted by the WDT_vect of the last run. Called once the usart is up.
+ */
+void wdt_report(void)
+{
+#ifdef PERSIST_ON
+    if(persist_warm){
+        for(uint8_t n = 1; n < PERSIST_CRUMBS; n++){        // 0 is this boot
+            uint8_t crumb = persist_last_crumb(n);
+
+            if(crumb == PERSIST_CRUMB_BOOT) return;         // an older run
+            if((crumb & 0xE0) == PERSIST_CRUMB_WATCHDOG(0)){
+                VERBOSE_MSG_ERROR(LOG_FMT("WATCHDOG: missed check-ins %02x\n",
+                    crumb & WDT_TASKS_MASK));
+                return;
+            }
+        }
+        return;
+    }
+#endif
+
+    if(wdt_mcusr & (1 << WDRF))
+        VERBOSE_MSG_ERROR(LOG_FMT("WATCHDOG: missed check-ins %02x\n", wdt_missed));
+}
+
+/**
+ * @brief first time-out: takes note of who is stuck. The hardware clears WDIE
+ * on the time-out, so the next one resets the system unless every task
+ * checks in again. Nothing is logged here, the usart would busy-wait in the
+ * isr; see wdt_report().
+ */
+ISR(WDT_vect)
+{
+    wdt_missed = ~WDT_CHECKINS & WDT_TASKS_MASK;
+
+#ifdef PERSIST_ON
+    persist_crumb(PERSIST_CRUMB_WATCHDOG(wdt_missed));
+#endif
+}
@@ -3,7 +3,18 @@
  *
  * @defgroup WATCHDOG Watchdog Module
  *
- * @brief A simple watchdog.
+ * @brief A watchdog fed by a supervisor of the tasks.
+ *
+ * Each task checks in by setting its bit in GPIOR0 (a single `sbi`, so it is
+ * safe from the ISRs). The watchdog is only reset by wdt_supervise() when
+ * every task has checked in since the last time, so a stuck task is caught
+ * even if the main loop keeps spinning.
+ *
+ * The watchdog runs in the interrupt and reset mode: the first time-out runs
+ * the WDT interrupt, which records the tasks that missed their check-in, and
+ * the second one resets the system. WDIE is cleared by the hardware on the
+ * first time-out even if the interrupts are off, so a stuck ISR still ends
+ * in a reset.
  *
  * A simple way to test the watchdog is to not call wdt_reset() and let it acts.
  *
@@ -14,28 +25,56 @@
 
 #include <avr/io.h>
 #include <avr/wdt.h>
+#include <avr/interrupt.h>
 
-/**
- * @brief This function is called upon a HARDWARE RESET:
- */
-void wdt_first(void) __attribute__((naked)) __attribute__((section(".init3")));
+#include "conf.h"
+#include "dbg_vrb.h"
+#include "../lib/bit_utils.h"
+#ifdef PERSIST_ON
+#include "persist.h"
+#endif
 
-/**
- * @brief Clear SREG_I on hardware reset.
- */
-void wdt_first(void)
-{
-    MCUSR = 0; // clear reset flags
-    wdt_disable();
-    //http://www.atmel.com/webdoc/AVRLibcReferenceManual/FAQ_1faq_softreset.html
-}
-
-/**	
- * @brief initialize watchdog with some predefined time
- */
-void wdt_init(void)
-{
-    wdt_enable(WDTO_4S);
-}
+typedef enum wdt_tasks{
+    WDT_TASK_ADC,                           //<! an adc frame was averaged
+    WDT_TASK_MACHINE,                       //<! machine tick
+    WDT_TASK_CAN,                           //<! can drained
+    WDT_TASKS,
+} wdt_tasks_t;
+
+#define WDT_CHECKINS                GPIOR0
+
+// tasks that must check in, the others are not built
+#define WDT_TASKS_MASK              ( 0                                 \
+                                    | WDT_TASK_BIT_ADC                  \
+                                    | WDT_TASK_BIT_MACHINE              \
+                                    | WDT_TASK_BIT_CAN)
+// with RECOVERY_ON the adc stalls are handled by recovery_task(), whose
+// backoffs do not fit the WDT_TIMEOUT window
+#if defined(ADC_ON) && !defined(RECOVERY_ON)
+#define WDT_TASK_BIT_ADC            (1 << WDT_TASK_ADC)
+#else
+#define WDT_TASK_BIT_ADC            0
+#endif
+#ifdef MACHINE_ON
+#define WDT_TASK_BIT_MACHINE        (1 << WDT_TASK_MACHINE)
+#else
+#define WDT_TASK_BIT_MACHINE        0
+#endif
+#ifdef CAN_ON
+#define WDT_TASK_BIT_CAN            (1 << WDT_TASK_CAN)
+#else
+#define WDT_TASK_BIT_CAN            0
+#endif
+
+#define wdt_checkin(task)           set_bit(WDT_CHECKINS, (task))
+
+extern uint8_t wdt_mcusr;
+extern uint8_t wdt_missed;
+
+void wdt_first(void) __attribute__((naked)) __attribute__((section(".init3")));
+void wdt_init(void);
+void wdt_report(void);
+void wdt_supervise(void);
+void wdt_fast_reset(void) __attribute__((noreturn));
 
 #endif /* ifndef WATCHDOG_H */
@@ -0,0 +1,120 @@
+#include "ws2812.h"
+
+ws2812_t ws2812;
+
+/**
+ * @brief sends count bytes MSB first. Interrupts must be off.
+ *
+ * Cycles from the rising edge (t = 0), every path is 20 cycles:
+ *
+ *      t   0       6       12      20
+ *      0   |‾‾‾‾‾‾‾|_______________|
+ *      1   |‾‾‾‾‾‾‾‾‾‾‾‾‾‾‾|_______|
+ */
+static void ws2812_send(const uint8_t *data, uint16_t count, uint8_t hi, uint8_t lo)
+{
+    uint8_t byte = *data++;
+    uint8_t bit = 8;
+    uint8_t next = lo;
+
+    __asm__ __volatile__(
+        "1:                         \n\t"   //                      t
+        "out    %[port], %[hi]      \n\t"   // 1    rising edge     0
+        "sbrc   %[byte], 7          \n\t"   // 1/2
+        "mov    %[next], %[hi]      \n\t"   // 1/0  next = bit      2
+        "dec    %[bit]              \n\t"   // 1                    3
+        "rjmp   .+0                 \n\t"   // 2                    5
+        "out    %[port], %[next]    \n\t"   // 1    falls on a 0    6
+        "mov    %[next], %[lo]      \n\t"   // 1                    7
+        "breq   2f                  \n\t"   // 1/2                  8
+        "lsl    %[byte]             \n\t"   // 1                    9
+        "rjmp   .+0                 \n\t"   // 2                    11
+        "out    %[port], %[lo]      \n\t"   // 1    falls on a 1    12
+        "rjmp   .+0                 \n\t"   // 2                    14
+        "rjmp   .+0                 \n\t"   // 2                    16
+        "nop                        \n\t"   // 1                    17
+        "rjmp   1b                  \n\t"   // 2                    19
+        "2:                         \n\t"   //                      9
+        "ldi    %[bit], 8           \n\t"   // 1                    10
+        "nop                        \n\t"   // 1                    11
+        "out    %[port], %[lo]      \n\t"   // 1    falls on a 1    12
+        "ld     %[byte], %a[data]+  \n\t"   // 2                    14
+        "sbiw   %[count], 1         \n\t"   // 2                    16
+        "breq   3f                  \n\t"   // 1                    17
+        "rjmp   1b                  \n\t"   // 2                    19
+        "3:                         \n\t"
+        : [byte] "+r" (byte), [bit] "+d" (bit), [next] "+r" (next),
+          [count] "+w" (count), [data] "+e" (data)
+        : [port] "I" (_SFR_IO_ADDR(WS2812_PORT)), [hi] "r" (hi), [lo] "r" (lo)
+    );
+}
+
+/**
+ * @brief sets the pin as output, low, and clears the strip.
+ */
+void ws2812_init(void)
+{
+    clr_bit(WS2812_PORT, WS2812);
+    set_bit(WS2812_DDR, WS2812);
+
+    ws2812.last = timer_now();
+    ws2812_fill(0, 0, 0);
+    ws2812_show();
+}
+
+/**
+ * @brief sets the colour of one led in the frame buffer.
+ */
+void ws2812_set(uint8_t n, uint8_t r, uint8_t g, uint8_t b)
+{
+    if(n >= WS2812_LEDS) return;
+
+    ws2812.led[n].r = r;
+    ws2812.led[n].g = g;
+    ws2812.led[n].b = b;
+    if(n >= ws2812.dirty) ws2812.dirty = n + 1;
+}
+
+/**
+ * @brief sets every led in the frame buffer to the same colour.
+ */
+void ws2812_fill(uint8_t r, uint8_t g, uint8_t b)
+{
+    for(uint8_t i = 0; i < WS2812_LEDS; i++){
+        ws2812.led[i].r = r;
+        ws2812.led[i].g = g;
+        ws2812.led[i].b = b;
+    }
+    ws2812.dirty = WS2812_LEDS;
+}
+
+/**
+ * @brief waits for the latch time of the previous frame, if it is still
+ * running.
+ */
+void ws2812_wait(void)
+{
+    while((uint16_t)(timer_now() - ws2812.last) < WS2812_RESET_TICKS);
+}
+
+/**
+ * @brief sends the frame up to the last changed led, after ws2812_wait().
+ */
+void ws2812_show(void)
+{
+    uint8_t hi, lo;
+
+    if(!ws2812.dirty) return;
+
+    ws2812_wait();
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+        // the other pins of the port can not change with interrupts off
+        hi = WS2812_PORT | (1 << WS2812);
+        lo = WS2812_PORT & ~(1 << WS2812);
+        ws2812_send((const uint8_t *)ws2812.led, ws2812.dirty * sizeof(ws2812_grb_t), hi, lo);
+    }
+
+    ws2812.dirty = 0;
+    ws2812.last = timer_now();
+}
@@ -0,0 +1,77 @@
+/**
+ * @file ws2812.h
+ *
+ * @defgroup WS2812 Addressable LED Strip Module
+ *
+ * @brief Output driver for a WS2812 (and compatible) LED strip on the SPI SS
+ * pin (PB2), with the frame buffer in SRAM. SS is an output while the SPI is
+ * the master, so it is free for general use; PB0 is the MCP2515 chip select.
+ *
+ * The bits are sent by an inline assembly loop with fixed timing for 16 MHz:
+ * 20 cycles per bit (1.25 us), high for 6 cycles (375 ns) on a 0 and 12
+ * cycles (750 ns) on a 1. Interrupts are off while sending, 30 us per LED,
+ * so WS2812_LEDS is capped by the tightest interrupt budget: the usart rx
+ * holds 3 characters (about 520 us at 57600 baud) before it overruns, below
+ * the 533 us of a timer1 pwm slot.
+ *
+ * The strip is a shift chain: each LED keeps the first 24 bits it receives
+ * and passes the rest on. So a partial update only sends the frame up to the
+ * last changed LED, and the ones after it keep their colour.
+ *
+ * @code
+ *  ws2812_set(0, 255, 0, 0);                // first LED red
+ *  ws2812_show();                           // sends LED 0 only
+ * @endcode
+ *
+ * The timing can be checked on simavr with a VCD trace of the pin, see
+ * tools/ws2812_vcd.py.
+ *
+ */
+
+#ifndef WS2812_H
+#define WS2812_H
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <util/atomic.h>
+
+#include "conf.h"
+#include "timer.h"
+#include "usart.h"
+#include "../lib/bit_utils.h"
+
+#if F_CPU != 16000000UL
+#error "the ws2812 bit loop is timed for 16 MHz"
+#endif
+
+#define WS2812_LED_US           30          //<! 24 bits of 1.25 us
+#define WS2812_IRQ_BUDGET_US    (3UL * 10 * 1000000 / (USART_BAUD))
+
+#if WS2812_LEDS * WS2812_LED_US > WS2812_IRQ_BUDGET_US
+#error "WS2812_LEDS too large: the frame is sent with interrupts off, see WS2812_IRQ_BUDGET_US"
+#endif
+
+#define WS2812_RESET_US         300         //<! low time that latches the frame
+#define WS2812_RESET_TICKS      ((WS2812_RESET_US + TIMER_TICK_US - 1) / TIMER_TICK_US + 1)
+
+typedef struct{
+    uint8_t g;                              //<! wire order is green, red, blue
+    uint8_t r;
+    uint8_t b;
+} ws2812_grb_t;
+
+typedef struct ws2812{
+    ws2812_grb_t led[WS2812_LEDS];
+    uint8_t dirty;                          //<! leds to be sent: last changed + 1
+    uint16_t last;                          //<! tick of the end of the last frame
+} ws2812_t;
+
+extern ws2812_t ws2812;
+
+void ws2812_init(void);
+void ws2812_set(uint8_t n, uint8_t r, uint8_t g, uint8_t b);
+void ws2812_fill(uint8_t r, uint8_t g, uint8_t b);
+void ws2812_wait(void);
+void ws2812_show(void);
+
+#endif /* ifndef WS2812_H */
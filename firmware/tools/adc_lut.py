@@ -0,0 +1,133 @@
+#!/usr/bin/env python3
+"""Builds the adc linearisation tables in src/adc_lut.h from calibration CSVs.
+
+Each CSV has one "adc,value" point per line (a header line and # comments
+are skipped): the averaged adc reading and the physical value it stands for.
+The points are joined by straight lines, held flat below the first point and
+extended past the last one (the last breakpoint is beyond full scale), and the
+result is sampled at the LUT breakpoints: 0, 1 << shift, ... full scale + 1,
+with shift = bits - log2(points - 1). See lib/lut.h.
+
+The firmware interpolates with an 8x8 multiply, so two breakpoints may not
+differ by more than 255. When a curve is too steep for 17 points, use 33,
+or a coarser unit.
+
+usage:
+    ./tools/adc_lut.py --bits 8 --points 17 \\
+        ADC1=tools/cal/motor_ramp_pot.csv ADC2=tools/cal/mcc_power_pot.csv \\
+        -o src/adc_lut.h
+"""
+
+import argparse
+import csv
+import sys
+
+OUTPUT = 'src/adc_lut.h'
+CHANNELS = ['ADC0', 'ADC1', 'ADC2', 'ADC3', 'ADC4', 'ADC5']
+STEP_MAX = 255
+
+
+def read_points(path):
+    points = []
+    with open(path) as f:
+        for row in csv.reader(f):
+            if not row or row[0].strip().startswith('#'):
+                continue
+            try:
+                points.append((float(row[0]), float(row[1])))
+            except ValueError:
+                if points:
+                    raise
+                continue                            # header
+    points.sort()
+    if len(points) < 2:
+        sys.exit('%s: needs at least two points' % path)
+    return points
+
+
+def evaluate(points, x):
+    if x <= points[0][0]:
+        return points[0][1]
+    for (x0, y0), (x1, y1) in zip(points, points[1:]):
+        if x <= x1 or (x1, y1) == points[-1]:
+            return y0 + (y1 - y0) * (x - x0) / (x1 - x0) if x1 != x0 else y1
+
+
+def build(points, bits, seg_2):
+    shift = bits - seg_2
+    table = [int(round(evaluate(points, i << shift))) for i in range((1 << seg_2) + 1)]
+
+    for i, y in enumerate(table):
+        if not 0 <= y <= 0xFFFF:
+            sys.exit('breakpoint %d is %d, out of 0..65535' % (i, y))
+    for i, (a, b) in enumerate(zip(table, table[1:])):
+        if abs(b - a) > STEP_MAX:
+            sys.exit('breakpoints %d and %d differ by %d (max %d): use more points '
+                     'or a coarser unit' % (i, i + 1, abs(b - a), STEP_MAX))
+    return table
+
+
+def header(args, tables):
+    lines = [
+        '// ----------------------------------------------------------------------------',
+        '/* adc linearisation tables, generated by tools/adc_lut.py:',
+        ' *',
+        ' *  %s' % ' '.join(['./tools/adc_lut.py'] + sys.argv[1:]),
+        ' *',
+        ' * Only included by adc.c.',
+        ' */',
+        '// ----------------------------------------------------------------------------',
+        '',
+        '#ifndef ADC_LUT_H',
+        '#define ADC_LUT_H',
+        '',
+        '#include "../lib/lut.h"',
+        '',
+        '#define ADC_LUT_BITS            %d' % args.bits,
+        '#define ADC_LUT_SEGMENTS_2      %d' % args.seg_2,
+        '',
+    ]
+    for ch, path, table in tables:
+        name = 'adc_lut_%s' % ch.lower()
+        lines.append('// %s' % path)
+        lines.append('static const uint16_t %s[LUT_SIZE(ADC_LUT_SEGMENTS_2)] PROGMEM = {' % name)
+        for i in range(0, len(table), 8):
+            lines.append('    ' + ', '.join('%5d' % y for y in table[i:i + 8]) + ',')
+        lines.append('};')
+        lines.append('#define ADC_LUT_%s              %s' % (ch, name))
+        lines.append('')
+    lines.append('#endif // ADC_LUT_H')
+    return '\n'.join(lines) + '\n'
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split('\n')[0])
+    parser.add_argument('--bits', type=int, default=8, choices=(8, 10),
+                        help='adc resolution (8 with ADC_8BITS)')
+    parser.add_argument('--points', type=int, default=17, choices=(17, 33),
+                        help='breakpoints per table')
+    parser.add_argument('channels', nargs='+', metavar='ADCn=file.csv')
+    parser.add_argument('-o', '--output', help='header path (default: stdout)')
+    args = parser.parse_args()
+
+    args.seg_2 = (args.points - 1).bit_length() - 1
+    if args.bits - args.seg_2 > 8:
+        sys.exit('%d points are too few for %d bits' % (args.points, args.bits))
+
+    tables = []
+    for arg in args.channels:
+        ch, _, path = arg.partition('=')
+        if ch not in CHANNELS or not path:
+            sys.exit('expected ADCn=file.csv, got %s' % arg)
+        tables.append((ch, path, build(read_points(path), args.bits, args.seg_2)))
+
+    text = header(args, tables)
+    if args.output:
+        with open(args.output, 'w') as f:
+            f.write(text)
+    else:
+        sys.stdout.write(text)
+
+
+if __name__ == '__main__':
+    main()
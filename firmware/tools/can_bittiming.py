@@ -0,0 +1,138 @@
+#!/usr/bin/env python3
+"""Solves the MCP2515 bit timing and writes lib/avr-can-lib/src/mcp2515_bittiming.h.
+
+The bit is split as SyncSeg (1 TQ) + PropSeg + PS1 + PS2, with TQ = 2 * BRP
+/ Fosc. Every BRP from 1 to 64 is tried. The best split is the one with the
+smallest bitrate error, then the sample point closest to the requested one,
+then the most TQ per bit (finer resynchronization), then the most even
+PropSeg/PS1 split (the longer PropSeg on a tie). PS2 must be longer than
+SJW. With --prop-delay-ns the PropSeg must cover the bus round trip (about
+2 * (cable * 5 ns/m + transceiver loop delay)).
+
+The header is used by BITRATE_CUSTOM, and the constraints are checked again
+by the preprocessor, so a hand edited header can not build an invalid
+configuration either.
+
+usage:
+    ./tools/can_bittiming.py --osc 16000000 --bitrate 1000000 --sample-point 75 --sjw 1
+    ./tools/can_bittiming.py --osc 20000000 --bitrate 500000 --sample-point 87.5 \\
+        --prop-delay-ns 400 -o lib/avr-can-lib/src/mcp2515_bittiming.h
+"""
+
+import argparse
+import sys
+
+BRP_MAX = 64
+NTQ_MIN, NTQ_MAX = 8, 25
+PROPSEG_MAX = PS1_MAX = PS2_MAX = 8
+PS2_MIN = 2                                     # information processing time
+SJW_MAX = 4
+
+OUTPUT = 'lib/avr-can-lib/src/mcp2515_bittiming.h'
+
+
+def splits(ntq, sjw):
+    """yields every (propseg, ps1, ps2) that the MCP2515 accepts for ntq TQ."""
+    for ps2 in range(max(PS2_MIN, sjw + 1), PS2_MAX + 1):   # PS2 > SJW
+        tseg1 = ntq - 1 - ps2
+        for ps1 in range(1, PS1_MAX + 1):
+            propseg = tseg1 - ps1
+            if 1 <= propseg <= PROPSEG_MAX and propseg + ps1 >= ps2:
+                yield propseg, ps1, ps2
+
+
+def solve(osc, bitrate, sample_point, sjw, prop_delay_ns):
+    best = None
+
+    for brp in range(1, BRP_MAX + 1):
+        tq_ns = 2e9 * brp / osc
+        for ntq in range(NTQ_MIN, NTQ_MAX + 1):
+            actual = osc / (2.0 * brp * ntq)
+            error = abs(actual - bitrate) / bitrate
+            for propseg, ps1, ps2 in splits(ntq, sjw):
+                if propseg * tq_ns < prop_delay_ns:
+                    continue
+                sp = 100.0 * (1 + propseg + ps1) / ntq
+                # a 1 ppm error is not worth a worse sample point
+                key = (round(error * 1e6), abs(sp - sample_point), -ntq,
+                       abs(propseg - ps1), brp)
+                if best is None or key < best[0]:
+                    best = (key, dict(brp=brp, ntq=ntq, propseg=propseg, ps1=ps1,
+                                      ps2=ps2, sjw=sjw, actual=actual,
+                                      error_ppm=round(error * 1e6),
+                                      sample_point=sp, tq_ns=tq_ns))
+    return best[1] if best else None
+
+
+def header(args, t):
+    cnf1 = ((t['sjw'] - 1) << 6) | (t['brp'] - 1)
+    cnf2 = 0x80 | ((t['ps1'] - 1) << 3) | (t['propseg'] - 1)
+    cnf3 = t['ps2'] - 1
+
+    return '''\
+// ----------------------------------------------------------------------------
+/* MCP2515 bit timing for BITRATE_CUSTOM, generated by tools/can_bittiming.py:
+ *
+ *  %(cmd)s
+ *
+ * %(osc)d Hz, %(bitrate)d bps -> %(actual).1f bps (%(error_ppm)d ppm),
+ * %(ntq)d TQ of %(tq_ns).1f ns, sample point %(sample_point).1f %%
+ * (CNF1 0x%(cnf1)02x, CNF2 0x%(cnf2)02x, CNF3 0x%(cnf3)02x)
+ */
+// ----------------------------------------------------------------------------
+
+#ifndef	MCP2515_BITTIMING_H
+#define	MCP2515_BITTIMING_H
+
+#define	MCP2515_BT_OSC				%(osc)dUL
+#define	MCP2515_BT_BITRATE			%(bitrate)dUL
+#define	MCP2515_BT_MAX_ERROR_PPM	%(max_error_ppm)dUL
+
+#define	MCP2515_BT_BRP				%(brp)d
+#define	MCP2515_BT_PROPSEG			%(propseg)d
+#define	MCP2515_BT_PS1				%(ps1)d
+#define	MCP2515_BT_PS2				%(ps2)d
+#define	MCP2515_BT_SJW				%(sjw)d
+
+#include "mcp2515_bittiming_check.h"
+
+#endif	// MCP2515_BITTIMING_H
+''' % dict(t, cmd=' '.join(['./tools/can_bittiming.py'] + sys.argv[1:]),
+           osc=args.osc, bitrate=args.bitrate, max_error_ppm=args.max_error_ppm,
+           cnf1=cnf1, cnf2=cnf2, cnf3=cnf3)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split('\n')[0])
+    parser.add_argument('--osc', type=int, required=True, help='MCP2515 oscillator in Hz')
+    parser.add_argument('--bitrate', type=int, required=True, help='in bps')
+    parser.add_argument('--sample-point', type=float, default=87.5, help='in %% (default 87.5)')
+    parser.add_argument('--sjw', type=int, default=1, choices=range(1, SJW_MAX + 1))
+    parser.add_argument('--prop-delay-ns', type=float, default=0,
+                        help='minimum PropSeg, the bus round trip delay')
+    parser.add_argument('--max-error-ppm', type=int, default=5000,
+                        help='rejected above it (default 5000, 0.5 %%)')
+    parser.add_argument('-o', '--output', help='header path (default: stdout)')
+    args = parser.parse_args()
+
+    t = solve(args.osc, args.bitrate, args.sample_point, args.sjw, args.prop_delay_ns)
+    if t is None:
+        sys.exit('no valid bit timing for %d Hz / %d bps' % (args.osc, args.bitrate))
+    if t['error_ppm'] > args.max_error_ppm:
+        sys.exit('best bit timing is %.1f bps, %d ppm off (max %d ppm)'
+                 % (t['actual'], t['error_ppm'], args.max_error_ppm))
+
+    sys.stderr.write('BRP %(brp)d PropSeg %(propseg)d PS1 %(ps1)d PS2 %(ps2)d SJW %(sjw)d: '
+                     '%(actual).1f bps (%(error_ppm)d ppm), sample point %(sample_point).1f %%\n'
+                     % t)
+
+    text = header(args, t)
+    if args.output:
+        with open(args.output, 'w') as f:
+            f.write(text)
+    else:
+        sys.stdout.write(text)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,140 @@
+#!/usr/bin/env python3
+"""Decodes the tokenized log stream (LOG_TOKENIZED_ON, see src/log.h).
+
+The dictionary is rebuilt from the `.logstr` section of the elf, where each
+log site left its 16-bit id followed by its null terminated format string.
+Bytes outside of a record are printed as they are.
+
+usage:
+    stty -F /dev/ttyUSB0 57600 raw
+    ./tools/log_decode.py bin/firmware.elf /dev/ttyUSB0
+    ./tools/log_decode.py bin/firmware.elf --dump
+"""
+
+import re
+import struct
+import sys
+
+LOG_SYNC = 0x1E
+LOG_SITE_BITS = 11
+LOG_SECTION = '.logstr'
+
+CONVERSION = re.compile(r'%([-0 +#]*)(\d*)(hh|h|l)?([udixXc%])')
+
+
+def read_dictionary(path):
+    with open(path, 'rb') as f:
+        elf = f.read()
+
+    if elf[:4] != b'\x7fELF' or elf[4] != 1 or elf[5] != 1:
+        sys.exit('%s: not a 32-bit little endian elf' % path)
+
+    shoff, = struct.unpack_from('<I', elf, 0x20)
+    shentsize, shnum, shstrndx = struct.unpack_from('<HHH', elf, 0x2E)
+
+    def section(i):
+        return struct.unpack_from('<IIIIII', elf, shoff + i * shentsize)
+
+    strtab = section(shstrndx)
+    for i in range(shnum):
+        name, _, _, _, offset, size = section(i)
+        end = elf.index(b'\0', strtab[4] + name)
+        if elf[strtab[4] + name:end].decode() == LOG_SECTION:
+            break
+    else:
+        sys.exit('%s: no %s section, was it built with LOG_TOKENIZED_ON?'
+                 % (path, LOG_SECTION))
+
+    data = elf[offset:offset + size]
+    dictionary = {}
+    i = 0
+    while i + 2 < len(data):
+        log_id, = struct.unpack_from('<H', data, i)
+        end = data.index(b'\0', i + 2)
+        fmt = data[i + 2:end].decode('latin-1')
+        if log_id in dictionary and dictionary[log_id] != fmt:
+            sys.stderr.write('warning: id 0x%04x is used by more than one site\n'
+                             % log_id)
+        dictionary[log_id] = fmt
+        i = end + 1
+
+    return dictionary
+
+
+def words_of(fmt):
+    return sum(2 if m.group(3) == 'l' else 1
+               for m in CONVERSION.finditer(fmt) if m.group(4) != '%')
+
+
+def format_record(fmt, words):
+    words = iter(words)
+
+    def convert(m):
+        flags, width, length, conv = m.groups()
+        if conv == '%':
+            return '%'
+        value = next(words)
+        bits = 16
+        if length == 'l':
+            value |= next(words) << 16
+            bits = 32
+        if conv in 'di' and value >> (bits - 1):
+            value -= 1 << bits
+        if conv == 'c':
+            return chr(value & 0xFF)
+        return ('%' + flags + width + ('d' if conv in 'ui' else conv)) % value
+
+    return CONVERSION.sub(convert, fmt)
+
+
+def decode(dictionary, stream, out):
+    while True:
+        b = stream.read(1)
+        if not b:
+            return
+        if b[0] != LOG_SYNC:
+            out.write(b.decode('latin-1'))
+            continue
+
+        header = stream.read(2)
+        if len(header) < 2:
+            return
+        log_id, = struct.unpack('<H', header)
+        fmt = dictionary.get(log_id)
+        if fmt is None:
+            out.write('<unknown log id 0x%04x (module %d)>\n'
+                      % (log_id, log_id >> LOG_SITE_BITS))
+            continue
+
+        n = words_of(fmt)
+        payload = stream.read(2 * n)
+        if len(payload) < 2 * n:
+            return
+        out.write(format_record(fmt, struct.unpack('<%dH' % n, payload)))
+        out.flush()
+
+
+def main(argv):
+    if len(argv) < 2:
+        sys.exit(__doc__)
+
+    dictionary = read_dictionary(argv[1])
+
+    if len(argv) > 2 and argv[2] == '--dump':
+        for log_id in sorted(dictionary):
+            print('0x%04x module %2d: %r' % (log_id, log_id >> LOG_SITE_BITS,
+                                             dictionary[log_id]))
+        return
+
+    if len(argv) > 2:
+        with open(argv[2], 'rb', buffering=0) as stream:
+            decode(dictionary, stream, sys.stdout)
+    else:
+        decode(dictionary, sys.stdin.buffer, sys.stdout)
+
+
+if __name__ == '__main__':
+    try:
+        main(sys.argv)
+    except KeyboardInterrupt:
+        pass
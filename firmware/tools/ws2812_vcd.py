@@ -0,0 +1,107 @@
+#!/usr/bin/env python3
+"""Checks the WS2812 bit timing in a VCD trace of the strip pin.
+
+The trace comes from simavr running the firmware, with the strip pin traced
+(PB2 with the default conf.h), e.g. with simavr's VCD output or a gtkwave
+dump of the run. Every high pulse is a bit: it is a 0 when shorter than
+T_SPLIT and a 1 otherwise, and a low time longer than T_RESET ends a frame.
+
+The high times and the bit periods are checked against the WS2812B
+datasheet (T0H 0.4 us, T1H 0.8 us, +-150 ns each, period 1.25 us +-600 ns).
+The decoded frames are printed as GRB bytes.
+
+usage:
+    ./tools/ws2812_vcd.py trace.vcd
+    ./tools/ws2812_vcd.py trace.vcd --signal PORTB2
+"""
+
+import argparse
+import re
+import sys
+
+UNITS = {'s': 1e9, 'ms': 1e6, 'us': 1e3, 'ns': 1.0, 'ps': 1e-3, 'fs': 1e-6}
+
+T0H = (250, 550)                                # ns
+T1H = (650, 950)
+PERIOD = (650, 1850)
+T_SPLIT = 600
+T_RESET = 50000
+
+
+def parse(path, signal):
+    """returns the (time in ns, level) changes of the signal."""
+    text = open(path).read()
+
+    m = re.search(r'\$timescale\s+(\d+)\s*(\w+)\s+\$end', text)
+    scale = int(m.group(1)) * UNITS[m.group(2)] if m else 1.0
+
+    ids = dict((name, code) for code, name in
+               re.findall(r'\$var\s+\S+\s+\d+\s+(\S+)\s+(\S+)(?:\s+\[\S+\])?\s+\$end', text))
+    code = ids.get(signal)
+    if code is None:
+        match = [n for n in ids if signal.lower() in n.lower()]
+        if len(match) != 1:
+            sys.exit('signal %s not found, the trace has: %s' % (signal, ' '.join(sorted(ids))))
+        code = ids[match[0]]
+
+    body = text.split('$enddefinitions', 1)[1]
+    t, changes, pending = 0, [], None
+    for tok in body.split():
+        if tok.startswith('#'):
+            t = int(tok[1:]) * scale
+        elif tok[0] in '01xz' and tok[1:] == code:
+            changes.append((t, 1 if tok[0] == '1' else 0))
+        elif pending and tok == code:
+            changes.append((t, 1 if pending[-1] == '1' else 0))
+        pending = tok if tok[0] == 'b' else None    # a vector value, its code follows
+    return changes
+
+
+def check(changes):
+    frames, bits, errors = [], [], 0
+    edges = [(t, v) for i, (t, v) in enumerate(changes) if i == 0 or v != changes[i - 1][1]]
+
+    for i in range(len(edges) - 1):
+        t, v = edges[i]
+        dt = edges[i + 1][0] - t
+        if v == 1:
+            bit = 0 if dt < T_SPLIT else 1
+            lo, hi = T0H if bit == 0 else T1H
+            if not lo <= dt <= hi:
+                print('%10.0f ns: T%dH %.0f ns out of %d..%d' % (t, bit, dt, lo, hi))
+                errors += 1
+            if i + 2 < len(edges) and edges[i + 2][0] - t < T_RESET:
+                period = edges[i + 2][0] - t
+                if not PERIOD[0] <= period <= PERIOD[1]:
+                    print('%10.0f ns: period %.0f ns out of %d..%d' % (t, period, *PERIOD))
+                    errors += 1
+            bits.append(bit)
+        elif dt >= T_RESET and bits:
+            frames.append(bits)
+            bits = []
+    if bits:
+        frames.append(bits)
+    return frames, errors
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split('\n')[0])
+    parser.add_argument('vcd')
+    parser.add_argument('--signal', default='PORTB2', help='traced pin (default PORTB2)')
+    args = parser.parse_args()
+
+    frames, errors = check(parse(args.vcd, args.signal))
+
+    for n, bits in enumerate(frames):
+        data = [int(''.join(map(str, bits[i:i + 8])), 2) for i in range(0, len(bits) - 7, 8)]
+        print('frame %d: %d leds%s' % (n, len(bits) // 24, ' (%d stray bits)' % (len(bits) % 24)
+                                       if len(bits) % 24 else ''))
+        for i in range(0, len(data) - 2, 3):
+            print('  led %d: g %02x r %02x b %02x' % (i // 3, data[i], data[i + 1], data[i + 2]))
+
+    print('%d frames, %d timing errors' % (len(frames), errors))
+    sys.exit(1 if errors or not frames else 0)
+
+
+if __name__ == '__main__':
+    main()